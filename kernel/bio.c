@@ -19,6 +19,8 @@
 #include "spinlock.h"
 #include "sleeplock.h"
 #include "riscv.h"
+#include "trace.h"
+#include "iostat.h"
 #include "defs.h"
 #include "fs.h"
 #include "buf.h"
@@ -31,6 +33,10 @@ struct {
   // Sorted by how recently the buffer was used.
   // head.next is most recent, head.prev is least.
   struct buf head;
+
+  uint64 hits;    // see struct iostats
+  uint64 misses;
+  uint64 evicts;
 } bcache;
 
 void
@@ -72,6 +78,7 @@ bget(uint dev, uint blockno)
     if(b->dev == dev && b->blockno == blockno){
       // このブロックを使っているプロセス数を増やして終了
       b->refcnt++;
+      bcache.hits++;
       release(&bcache.lock);
       // 各ブロックキャッシュが保持する lock は、バッファされている内容の
       // 読み書きが矛盾しないようにするためのもの
@@ -87,6 +94,9 @@ bget(uint dev, uint blockno)
   for(b = bcache.head.prev; b != &bcache.head; b = b->prev){
     // 参照カウントが 0 なら使われていないということなので、これを再利用する
     if(b->refcnt == 0) {
+      bcache.misses++;
+      if(b->valid)
+        bcache.evicts++;
       b->dev = dev;
       b->blockno = blockno;
       // valid を 0 にすると、bread がディスクから読み直す
@@ -114,8 +124,11 @@ bread(uint dev, uint blockno)
   b = bget(dev, blockno);
   // 返ってきたバッファが valid でなかったらディスクから読み直す
   if(!b->valid) {
+    TRACE(TR_BMISS, blockno, 0);
     virtio_disk_rw(b, 0);
     b->valid = 1;
+  } else {
+    TRACE(TR_BHIT, blockno, 0);
   }
   return b;
 }
@@ -138,6 +151,7 @@ brelse(struct buf *b)
 {
   if(!holdingsleep(&b->lock))
     panic("brelse");
+  TRACE(TR_BRELSE, b->blockno, 0);
 
   // brelse しないとブロックキャッシュのロックを開放しない(他プロセスが使えない)ので注意
   releasesleep(&b->lock);
@@ -174,4 +188,13 @@ bunpin(struct buf *b) {
   release(&bcache.lock);
 }
 
-
+// Add the buffer cache's statistics to *st.
+void
+bstats(struct iostats *st)
+{
+  acquire(&bcache.lock);
+  st->bhits = bcache.hits;
+  st->bmisses = bcache.misses;
+  st->bevicts = bcache.evicts;
+  release(&bcache.lock);
+}
@@ -2,12 +2,22 @@ struct buf;
 struct context;
 struct file;
 struct inode;
+struct iostats;
+struct memstats;
+struct iovec;
+struct lockclass;
+struct pollent;
+struct pollq;
 struct pipe;
 struct proc;
 struct spinlock;
 struct sleeplock;
+struct slabcache;
 struct stat;
 struct superblock;
+struct sysacct;
+struct sysstat;
+struct vdso;
 
 // bio.c
 void            binit(void);
@@ -16,6 +26,7 @@ void            brelse(struct buf*);
 void            bwrite(struct buf*);
 void            bpin(struct buf*);
 void            bunpin(struct buf*);
+void            bstats(struct iostats*);
 
 // console.c
 void            consoleinit(void);
@@ -24,6 +35,7 @@ void            consputc(int);
 
 // exec.c
 int             exec(char*, char**);
+int             execproc(struct proc*, char*, char**);
 
 // file.c
 struct file*    filealloc(void);
@@ -33,6 +45,15 @@ void            fileinit(void);
 int             fileread(struct file*, uint64, int n);
 int             filestat(struct file*, uint64 addr);
 int             filewrite(struct file*, uint64, int n);
+int             filereadv(struct file*, struct iovec*, int, int);
+int             filewritev(struct file*, struct iovec*, int, int);
+int             filepoll(struct file*, struct pollent*);
+struct file*    fdget(struct proc*, int);
+int             fdalloc(struct proc*, struct file*);
+int             fdinstall(struct proc*, int, struct file*);
+struct file*    fdclear(struct proc*, int);
+int             fdcopy(struct proc*, struct proc*);
+void            fdcloseall(struct proc*);
 
 // fs.c
 void            fsinit(int);
@@ -50,6 +71,7 @@ int             namecmp(const char*, const char*);
 struct inode*   namei(char*);
 struct inode*   nameiparent(char*, char*);
 int             readi(struct inode*, int, uint64, uint, uint);
+int             ireadpage(struct inode*, char*, uint);
 void            stati(struct inode*, struct stat*);
 int             writei(struct inode*, int, uint64, uint, uint);
 void            itrunc(struct inode*);
@@ -61,20 +83,68 @@ void            ramdiskrw(struct buf*);
 
 // kalloc.c
 void*           kalloc(void);
+void*           kalloc_zeroed(void);
 void            kfree(void *);
+int             kzerofill(void);
+void            kmemstats(struct memstats*);
 void            kinit(void);
 
+// slab.c
+void            slabinit(struct slabcache*, char*, uint);
+void*           slaballoc(struct slabcache*);
+void            slabfree(void*);
+void            kmallocinit(void);
+void*           kmalloc(uint);
+void            kmfree(void*);
+
 // log.c
 void            initlog(int, struct superblock*);
 void            log_write(struct buf*);
 void            begin_op(void);
 void            end_op(void);
+void            log_sync(void);
+void            logstats(struct iostats*);
+
+// iostat.c
+void            iostatinit(void);
+
+// memstat.c
+void            memstatinit(void);
+
+// lockstat.c
+struct lockclass* lockclass(char*, int);
+void            lockacct(struct lockclass*, int, uint64, uint64, uint64);
+void            lockstatinit(void);
+
+// prof.c
+void            profinit(void);
+void            profintr(void);
+
+// trace.c
+extern volatile int tracing;
+void            traceinit(void);
+void            traceput(int, uint64, uint64);
+#define TRACE(ev, a0, a1) do { if(tracing) traceput(ev, a0, a1); } while(0)
+
+// perf.c
+void            perfin(struct proc*);
+void            perfout(struct proc*);
+
+// pcache.c
+void            pcinit(void);
+uint64          pcget(struct inode*, uint);
+void            pcdup(uint64);
+void            pcput(uint64);
+void            pcdrop(struct inode*, uint, uint);
+void            pcupdate(struct inode*, uint, char*, uint);
+int             pcevict(void);
 
 // pipe.c
 int             pipealloc(struct file**, struct file**);
 void            pipeclose(struct pipe*, int);
-int             piperead(struct pipe*, uint64, int);
-int             pipewrite(struct pipe*, uint64, int);
+int             piperead(struct pipe*, uint64, int, int);
+int             pipewrite(struct pipe*, uint64, int, int);
+int             pipepoll(struct pipe*, int, struct pollent*);
 
 // printf.c
 void            printf(char*, ...);
@@ -85,12 +155,17 @@ void            printfinit(void);
 int             cpuid(void);
 void            exit(int);
 int             fork(void);
+struct proc*    spawnalloc(void);
+void            spawnfree(struct proc*);
+void            procstart(struct proc*);
 int             growproc(int);
-void            proc_mapstacks(pagetable_t);
 pagetable_t     proc_pagetable(struct proc *);
 void            proc_freepagetable(pagetable_t, uint64);
 int             kill(int);
 int             killed(struct proc*);
+int             procsysacct(int, int, struct sysacct*);
+int             procinfo(uint64, int);
+struct proc*    procnext(struct proc*);
 void            setkilled(struct proc*);
 struct cpu*     mycpu(void);
 struct cpu*     getmycpu(void);
@@ -106,6 +181,14 @@ void            yield(void);
 int             either_copyout(int user_dst, uint64 dst, void *src, uint64 len);
 int             either_copyin(void *dst, int user_src, uint64 src, uint64 len);
 void            procdump(void);
+extern struct spinlock polllock;
+void            pollqadd(struct pollq*, struct spinlock*, struct pollent*);
+void            pollqdel(struct pollent*);
+void            pollwake(struct pollq*);
+
+// uaccess.S
+int             ucopy(void*, void*, uint64);
+int             ucopystr(char*, char*, uint64);
 
 // swtch.S
 void            swtch(struct context*, struct context*);
@@ -133,6 +216,13 @@ int             strlen(const char*);
 int             strncmp(const char*, const char*, uint);
 char*           strncpy(char*, const char*, int);
 
+// swap.c
+void            swapinit(struct superblock*);
+int             swapout(void);
+int             swapin(pagetable_t, uint64);
+void            swapdup(uint);
+void            swapfree(uint);
+
 // syscall.c
 void            argint(int, int*);
 int             argstr(int, char*, int);
@@ -140,12 +230,15 @@ void            argaddr(int, uint64 *);
 int             fetchstr(uint64, char*, int);
 int             fetchaddr(uint64, uint64*);
 void            syscall();
+void            syscallstat(int, struct sysstat*);
 
 // trap.c
 extern uint     ticks;
+extern struct vdso *vdso;
 void            trapinit(void);
 void            trapinithart(void);
 extern struct spinlock tickslock;
+extern struct pollq tickq;
 void            usertrapret(void);
 
 // uart.c
@@ -158,7 +251,18 @@ int             uartgetc(void);
 // vm.c
 void            kvminit(void);
 void            kvminithart(void);
+uint64          uvmsatp(struct proc*);
+void            uvmswitch(struct proc*);
+void            uvmflush(pagetable_t);
+void            kvmswitch(void);
+#ifdef SHAREDPT
+int             kvmshare(pagetable_t);
+void            kvmunshare(pagetable_t);
+#endif
 void            kvmmap(pagetable_t, uint64, uint64, uint64, int);
+int             kvmstack(uint64);
+void            kvmunstack(uint64);
+void            kvmstacksync(void);
 int             mappages(pagetable_t, uint64, uint64, uint64, int);
 pagetable_t     uvmcreate(void);
 void            uvmfirst(pagetable_t, uchar *, uint);
@@ -166,8 +270,12 @@ uint64          uvmalloc(pagetable_t, uint64, uint64, int);
 uint64          uvmdealloc(pagetable_t, uint64, uint64);
 int             uvmcopy(pagetable_t, pagetable_t, uint64);
 void            uvmfree(pagetable_t, uint64);
+uint64          uvmresident(pagetable_t, uint64, uint64*);
 void            uvmunmap(pagetable_t, uint64, uint64, int);
 void            uvmclear(pagetable_t, uint64);
+int             uvmfault(pagetable_t, uint64);
+void            uvmpin(uint64, int);
+void            uvmunpin(void);
 pte_t *         walk(pagetable_t, uint64, int);
 uint64          walkaddr(pagetable_t, uint64);
 int             copyout(pagetable_t, uint64, char *, uint64);
@@ -183,7 +291,9 @@ void            plic_complete(int);
 // virtio_disk.c
 void            virtio_disk_init(void);
 void            virtio_disk_rw(struct buf *, int);
+void            virtio_disk_page(uint, void*, int);
 void            virtio_disk_intr(void);
+void            diskstats(struct iostats*);
 
 // number of elements in fixed-size array
 #define NELEM(x) (sizeof(x)/sizeof((x)[0]))
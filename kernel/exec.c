@@ -8,6 +8,7 @@
 #include "elf.h"
 
 static int loadseg(pde_t *, uint64, struct inode *, uint, uint);
+static int mapseg(pde_t *, uint64, struct inode *, uint, uint, int);
 
 int flags2perm(int flags)
 {
@@ -29,21 +30,29 @@ int flags2perm(int flags)
 //         trampoline.S/userret
 int
 exec(char *path, char **argv)
+{
+  return execproc(myproc(), path, argv);
+}
+
+// Replace p's user image with the program in path. p is
+// either the current process or a new one from spawnalloc().
+int
+execproc(struct proc *p, char *path, char **argv)
 {
   char *s, *last;
   int i, off;
-  uint64 argc, sz = 0, sp, ustack[MAXARG], stackbase;
+  uint64 argc, sz = 0, sp, ustack[MAXARG], stackbase, stackbot;
   struct elfhdr elf;
   struct inode *ip;
   struct proghdr ph;
   pagetable_t pagetable = 0, oldpagetable;
-  struct proc *p = myproc();
-
-  begin_op();
 
+  // loading the program only reads the file system, so it
+  // holds no transaction, which would keep the log from
+  // committing until it was done. iput() starts one if it
+  // has to free ip.
   // ファイルを開く
   if((ip = namei(path)) == 0){
-    end_op();
     return -1;
   }
   ilock(ip);
@@ -77,6 +86,21 @@ exec(char *path, char **argv)
       goto bad;
 
     uint64 sz1;
+    if((ph.flags & ELF_PROG_FLAG_WRITE) == 0 && ph.off % PGSIZE == 0 &&
+       ph.memsz == ph.filesz && PGROUNDUP(sz) <= ph.vaddr){
+      // a read-only segment, such as the program's text:
+      // map the page cache's copy rather than making one.
+      if(PGROUNDUP(sz) < ph.vaddr){
+        if((sz1 = uvmalloc(pagetable, sz, ph.vaddr, flags2perm(ph.flags))) == 0)
+          goto bad;
+        sz = sz1;
+      }
+      if(mapseg(pagetable, ph.vaddr, ip, ph.off, ph.filesz, flags2perm(ph.flags)) < 0)
+        goto bad;
+      sz = ph.vaddr + ph.memsz;
+      continue;
+    }
+
     // 元々サイズは 0 で、それを必要なサイズ(ph.vaddr + ph.memsz)まで広げる
     // vaddr はロード先の仮想アドレス、memsz はこのセグメントが使うサイズ
     // つまり、仮想アドレス 0 から、必要なすべての範囲に対してページを割り当てている
@@ -90,36 +114,33 @@ exec(char *path, char **argv)
       goto bad;
   }
   iunlockput(ip);
-  end_op();
   ip = 0;
   // ↑ここまでで elf のロードは終わり
 
-  p = myproc();
   uint64 oldsz = p->sz;
 
-  // Allocate two pages at the next page boundary.
-  // Make the first inaccessible as a stack guard.
-  // Use the second as the user stack.
-
-  // elf でロードしたサイズ(ページサイズ単位)を求めておき
-  // この次のアドレスには stack guard を置く
-  // その次にスタックを置く
+  // Allocate a page at the next page boundary and make it
+  // inaccessible as a stack guard. Above it, reserve
+  // MAXUSTACK pages for the user stack, but allocate only
+  // the top one; the stack grows down into the others as
+  // the program touches them (see uvmfault()).
   sz = PGROUNDUP(sz);
   uint64 sz1;
-  // 2ページ分確保
-  if((sz1 = uvmalloc(pagetable, sz, sz + 2*PGSIZE, PTE_W)) == 0)
+  if((sz1 = uvmalloc(pagetable, sz, sz + PGSIZE, PTE_W)) == 0)
     goto bad;
-  // 追加した2ページ分を含めてサイズ sz を更新
-  sz = sz1;
-  // 直前の uvmalloc で確保した2ページのうち、下位の1ページをユーザアクセス不可にする
   // text/data が仮想アドレス 0 から始まっているから、
   // sz は仮想アドレスと同じ値になっていることに注意
-  uvmclear(pagetable, sz-2*PGSIZE);
+  uvmclear(pagetable, sz);
+  stackbot = sz1;
+  sz = stackbot + (MAXUSTACK-1)*PGSIZE;
+  if((sz1 = uvmalloc(pagetable, sz, sz + PGSIZE, PTE_W)) == 0)
+    goto bad;
+  sz = sz1;
   // スタックポインタは確保したページの最上位アドレスに指定
   // (スタックは上位から下位に向かって、つまり stack guard の方向に伸びていく)
   // sp は、ユーザ側のアドレス空間の仮想アドレスなことに注意
   sp = sz;
-  // stack guard との境界を stackbase とする
+  // the arguments must fit in the top page.
   stackbase = sp - PGSIZE;
 
   // exec ではすべての引数は文字列で渡される
@@ -172,15 +193,30 @@ exec(char *path, char **argv)
       last = s+1;
   safestrcpy(p->name, last, sizeof(p->name));
     
-  // Commit to the user image.
+  // Commit to the user image. getprocinfo() may be looking
+  // at the old page table, under p->lock.
+  acquire(&p->lock);
   oldpagetable = p->pagetable;
   p->pagetable = pagetable;
+  release(&p->lock);
+  p->asid = 0;  // the old ASID's TLB entries map the old image
+#ifdef SHAREDPT
+  // the kernel is running on the old page table.
+  if(p == myproc())
+    uvmswitch(p);
+#endif
   p->sz = sz;
+  p->ustack = stackbot;
   p->trapframe->epc = elf.entry;  // initial program counter = main
   p->trapframe->sp = sp; // initial stack pointer
 
   // 新しいプログラムを実行できるようになったら、古いページを開放する
   proc_freepagetable(oldpagetable, oldsz);
+  if(p->ring){
+    // the new image has not asked for a ring.
+    kfree((void*)p->ring);
+    p->ring = 0;
+  }
 
   // return すると a0 に argc の値が書かれる(calling convention)ので、
   // 明示的に a0 にデータを入れる必要はない
@@ -194,7 +230,6 @@ exec(char *path, char **argv)
     proc_freepagetable(pagetable, sz);
   if(ip){
     iunlockput(ip);
-    end_op();
   }
   return -1;
 }
@@ -226,3 +261,40 @@ loadseg(pagetable_t pagetable, uint64 va, struct inode *ip, uint offset, uint sz
   
   return 0;
 }
+
+// Map a read-only segment at virtual address va, using the
+// page cache's pages where it can, and private copies if the
+// page cache is full. va and offset must be page-aligned,
+// and nothing may be mapped at va yet.
+// Returns 0 on success, -1 on failure, when nothing new is
+// left mapped.
+static int
+mapseg(pagetable_t pagetable, uint64 va, struct inode *ip, uint offset, uint sz, int perm)
+{
+  uint i, n;
+  uint64 pa;
+  char *mem;
+
+  for(i = 0; i < sz; i += PGSIZE){
+    if((pa = pcget(ip, offset+i)) != 0){
+      if(mappages(pagetable, va+i, PGSIZE, pa, PTE_R|PTE_U|PTE_S|perm) != 0){
+        pcput(pa);
+        goto bad;
+      }
+      continue;
+    }
+    if((mem = kalloc_zeroed()) == 0)
+      goto bad;
+    n = sz - i < PGSIZE ? sz - i : PGSIZE;
+    if(readi(ip, 0, (uint64)mem, offset+i, n) != n ||
+       mappages(pagetable, va+i, PGSIZE, (uint64)mem, PTE_R|PTE_U|perm) != 0){
+      kfree(mem);
+      goto bad;
+    }
+  }
+  return 0;
+
+ bad:
+  uvmunmap(pagetable, va, i/PGSIZE, 1);
+  return -1;
+}
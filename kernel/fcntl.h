@@ -3,3 +3,26 @@
 #define O_RDWR    0x002
 #define O_CREATE  0x200
 #define O_TRUNC   0x400
+#define O_NONBLOCK 0x800
+
+// fcntl() commands
+#define F_GETFL   3  // return the open mode and O_NONBLOCK
+#define F_SETFL   4  // set O_NONBLOCK from arg
+
+// spawn() file actions, carried out in order in the child
+#define SPAWN_OPEN  1  // open path with mode arg as fd
+#define SPAWN_DUP   2  // make fd a copy of fd arg
+#define SPAWN_CLOSE 3  // close fd
+
+struct spawnfa {
+  int op;
+  int fd;
+  int arg;
+  char *path;
+};
+
+// one buffer for readv() and writev()
+struct iovec {
+  void *iov_base;
+  uint64 iov_len;
+};
@@ -10,19 +10,27 @@
 #include "spinlock.h"
 #include "sleeplock.h"
 #include "file.h"
+#include "fcntl.h"
+#include "poll.h"
 #include "stat.h"
 #include "proc.h"
+#include "slab.h"
 
 struct devsw devsw[NDEV];
+
+// Open files come from a slab cache, so there is no fixed
+// limit on how many there are. ftable.lock protects their
+// reference counts.
 struct {
   struct spinlock lock;
-  struct file file[NFILE];
+  struct slabcache cache;
 } ftable;
 
 void
 fileinit(void)
 {
   initlock(&ftable.lock, "ftable");
+  slabinit(&ftable.cache, "file", sizeof(struct file));
 }
 
 // Allocate a file structure.
@@ -31,17 +39,11 @@ filealloc(void)
 {
   struct file *f;
 
-  acquire(&ftable.lock);
-  for(f = ftable.file; f < ftable.file + NFILE; f++){
-    // ファイルの参照(ref)が 0 のもの(使っていないもの)を探す
-    if(f->ref == 0){
-      f->ref = 1;
-      release(&ftable.lock);
-      return f;
-    }
-  }
-  release(&ftable.lock);
-  return 0;
+  if((f = slaballoc(&ftable.cache)) == 0)
+    return 0;
+  memset(f, 0, sizeof(*f));
+  f->ref = 1;
+  return f;
 }
 
 // Increment ref count for file f.
@@ -76,6 +78,7 @@ fileclose(struct file *f)
   f->ref = 0;
   f->type = FD_NONE;
   release(&ftable.lock);
+  slabfree(f);
 
   // インタフェースは同じファイルでも、実体(ファイル or パイプ)によって閉じ方がかわる
   if(ff.type == FD_PIPE){
@@ -87,6 +90,120 @@ fileclose(struct file *f)
   }
 }
 
+// File descriptor tables.
+//
+// p->ofile starts out as p->ofile0, NOFILE slots inside the
+// struct proc, and is replaced by a kmalloc()ed table twice
+// the size whenever it fills up, up to MAXFD slots. The
+// p->fdused bitmap marks the slots in use, so that fdalloc()
+// finds the lowest free one 64 at a time. Only p itself uses
+// its table, so no lock is needed.
+
+// The open file for fd in p, or 0.
+struct file*
+fdget(struct proc *p, int fd)
+{
+  if(fd < 0 || fd >= p->nofile)
+    return 0;
+  return p->ofile[fd];
+}
+
+// Make p's table at least n slots long.
+static int
+fdgrow(struct proc *p, int n)
+{
+  struct file **t;
+  int nn;
+
+  for(nn = p->nofile; nn < n; nn *= 2)
+    ;
+  if(nn > MAXFD || (t = kmalloc(nn * sizeof(*t))) == 0)
+    return -1;
+  memset(t, 0, nn * sizeof(*t));
+  memmove(t, p->ofile, p->nofile * sizeof(*t));
+  if(p->ofile != p->ofile0)
+    kmfree(p->ofile);
+  p->ofile = t;
+  p->nofile = nn;
+  return 0;
+}
+
+// Allocate the lowest free file descriptor in p for f.
+// Takes over file reference from caller on success.
+int
+fdalloc(struct proc *p, struct file *f)
+{
+  uint64 free;
+  int i, fd;
+
+  for(i = 0; i < MAXFD/64; i++)
+    if((free = ~p->fdused[i]) != 0)
+      break;
+  if(i == MAXFD/64)
+    return -1;
+  for(fd = i*64; (free & 1) == 0; fd++)
+    free >>= 1;
+  if(fd >= p->nofile && fdgrow(p, fd+1) < 0)
+    return -1;
+  p->fdused[fd/64] |= 1L << (fd%64);
+  p->ofile[fd] = f;
+  return fd;
+}
+
+// Put f in p's table as fd, which must not be open.
+// Takes over file reference from caller on success.
+int
+fdinstall(struct proc *p, int fd, struct file *f)
+{
+  if(fd < 0 || fd >= MAXFD)
+    return -1;
+  if(fd >= p->nofile && fdgrow(p, fd+1) < 0)
+    return -1;
+  if(p->ofile[fd])
+    panic("fdinstall");
+  p->fdused[fd/64] |= 1L << (fd%64);
+  p->ofile[fd] = f;
+  return 0;
+}
+
+// Remove fd from p's table. Returns its file, which the
+// caller must close, or 0 if fd was not open.
+struct file*
+fdclear(struct proc *p, int fd)
+{
+  struct file *f;
+
+  if((f = fdget(p, fd)) == 0)
+    return 0;
+  p->ofile[fd] = 0;
+  p->fdused[fd/64] &= ~(1L << (fd%64));
+  return f;
+}
+
+// Give np, a new child of p, all of p's file descriptors.
+int
+fdcopy(struct proc *np, struct proc *p)
+{
+  if(p->nofile > np->nofile && fdgrow(np, p->nofile) < 0)
+    return -1;
+  for(int fd = 0; fd < p->nofile; fd++)
+    if(p->ofile[fd])
+      np->ofile[fd] = filedup(p->ofile[fd]);
+  memmove(np->fdused, p->fdused, sizeof(p->fdused));
+  return 0;
+}
+
+// Close all of p's files. freeproc() gives back the table.
+void
+fdcloseall(struct proc *p)
+{
+  struct file *f;
+
+  for(int fd = 0; fd < p->nofile; fd++)
+    if((f = fdclear(p, fd)) != 0)
+      fileclose(f);
+}
+
 // Get metadata about file f.
 // addr is a user virtual address, pointing to a struct stat.
 int
@@ -106,10 +223,10 @@ filestat(struct file *f, uint64 addr)
   return -1;
 }
 
-// Read from file f.
-// addr is a user virtual address.
-int
-fileread(struct file *f, uint64 addr, int n)
+// Read from file f, waiting for data from a pipe or device
+// unless nonblock.
+static int
+fileread1(struct file *f, uint64 addr, int n, int nonblock)
 {
   int r = 0;
 
@@ -118,12 +235,17 @@ fileread(struct file *f, uint64 addr, int n)
 
   // ファイルの種類によって呼び分ける
   if(f->type == FD_PIPE){
-    r = piperead(f->pipe, addr, n);
+    // pipes and devices copy with a spinlock held.
+    uvmpin(addr, n);
+    r = piperead(f->pipe, addr, n, nonblock);
+    uvmunpin();
   } else if(f->type == FD_DEVICE){
     if(f->major < 0 || f->major >= NDEV || !devsw[f->major].read)
       return -1;
     // デバイスファイルの場合はデバイスごとに違う(関数ポインタで設定される)
-    r = devsw[f->major].read(1, addr, n);
+    uvmpin(addr, n);
+    r = devsw[f->major].read(1, addr, n, nonblock);
+    uvmunpin();
   } else if(f->type == FD_INODE){
     ilock(f->ip);
     if((r = readi(f->ip, 1, addr, f->off, n)) > 0)
@@ -133,9 +255,19 @@ fileread(struct file *f, uint64 addr, int n)
     panic("fileread");
   }
 
+  if(r > 0)
+    myproc()->acct.rbytes += r;
   return r;
 }
 
+// Read from file f.
+// addr is a user virtual address.
+int
+fileread(struct file *f, uint64 addr, int n)
+{
+  return fileread1(f, addr, n, f->nonblock);
+}
+
 // Write to file f.
 // addr is a user virtual address.
 int
@@ -147,11 +279,15 @@ filewrite(struct file *f, uint64 addr, int n)
     return -1;
 
   if(f->type == FD_PIPE){
-    ret = pipewrite(f->pipe, addr, n);
+    uvmpin(addr, n);
+    ret = pipewrite(f->pipe, addr, n, f->nonblock);
+    uvmunpin();
   } else if(f->type == FD_DEVICE){
     if(f->major < 0 || f->major >= NDEV || !devsw[f->major].write)
       return -1;
+    uvmpin(addr, n);
     ret = devsw[f->major].write(1, addr, n);
+    uvmunpin();
   } else if(f->type == FD_INODE){
     // max の計算式の意味はわからないが、一定サイズを超えないように writei を繰り返し呼ぶ
     // write a few blocks at a time to avoid exceeding
@@ -185,6 +321,141 @@ filewrite(struct file *f, uint64 addr, int n)
     panic("filewrite");
   }
 
+  if(ret > 0)
+    myproc()->acct.wbytes += ret;
   return ret;
 }
 
+// Return which of POLLIN, POLLOUT and POLLHUP hold for f.
+// If e is not 0, also put e on the wait queue of the object
+// behind f, so that the poller is woken when that changes;
+// pollqdel(e) undoes this.
+int
+filepoll(struct file *f, struct pollent *e)
+{
+  if(f->type == FD_PIPE)
+    return pipepoll(f->pipe, f->writable, e);
+  if(f->type == FD_DEVICE && f->major >= 0 && f->major < NDEV &&
+     devsw[f->major].poll)
+    return devsw[f->major].poll(e);
+  // reading or writing a file never waits for anyone else.
+  return POLLIN | POLLOUT;
+}
+
+// Read from file f into the iovcnt user buffers in iov, as a
+// single read of their total length would. off is the file
+// offset to read from, or -1 to use and advance f->off; only
+// inodes have offsets. An inode stays locked throughout, so
+// the buffers see one consistent snapshot of the file.
+int
+filereadv(struct file *f, struct iovec *iov, int iovcnt, int off)
+{
+  int i, r, tot = 0;
+  uint o;
+
+  if(f->readable == 0)
+    return -1;
+  if(off >= 0 && f->type != FD_INODE)
+    return -1;
+
+  if(f->type != FD_INODE){
+    // like read(), wait only for the first data.
+    for(i = 0; i < iovcnt; i++){
+      r = fileread1(f, (uint64)iov[i].iov_base, iov[i].iov_len,
+                    f->nonblock || tot > 0);
+      if(r < 0)
+        return tot > 0 ? tot : -1;
+      tot += r;
+      if(r < iov[i].iov_len)
+        break;
+    }
+    return tot;
+  }
+
+  ilock(f->ip);
+  o = off < 0 ? f->off : off;
+  for(i = 0; i < iovcnt; i++){
+    r = readi(f->ip, 1, (uint64)iov[i].iov_base, o, iov[i].iov_len);
+    if(r < 0){
+      if(tot == 0)
+        tot = -1;
+      break;
+    }
+    tot += r;
+    o += r;
+    if(r < iov[i].iov_len)
+      break;
+  }
+  if(off < 0)
+    f->off = o;
+  iunlock(f->ip);
+
+  if(tot > 0)
+    myproc()->acct.rbytes += tot;
+  return tot;
+}
+
+// Write the iovcnt user buffers in iov to file f, as a single
+// write of their total length would. off is as for filereadv().
+// Buffers are gathered into as few log transactions as the
+// transaction size allows, usually one.
+int
+filewritev(struct file *f, struct iovec *iov, int iovcnt, int off)
+{
+  int i, r, n, n1, done, tot = 0;
+  uint o;
+
+  if(f->writable == 0)
+    return -1;
+  if(off >= 0 && f->type != FD_INODE)
+    return -1;
+
+  if(f->type != FD_INODE){
+    for(i = 0; i < iovcnt; i++){
+      r = filewrite(f, (uint64)iov[i].iov_base, iov[i].iov_len);
+      if(r < 0)
+        return tot > 0 ? tot : -1;
+      tot += r;
+      if(r < iov[i].iov_len)
+        break;
+    }
+    return tot;
+  }
+
+  // as in filewrite().
+  int max = ((MAXOPBLOCKS-1-1-2) / 2) * BSIZE;
+  i = 0;
+  done = 0;  // bytes of iov[i] already written
+  r = n1 = 0;
+  while(i < iovcnt){
+    begin_op();
+    ilock(f->ip);
+    o = off < 0 ? f->off : off + tot;
+    for(n = 0; i < iovcnt && n < max; n += r){
+      n1 = iov[i].iov_len - done;
+      if(n1 > max - n)
+        n1 = max - n;
+      if((r = writei(f->ip, 1, (uint64)iov[i].iov_base + done, o, n1)) != n1){
+        if(r > 0)
+          o += r;
+        break;
+      }
+      o += r;
+      done += r;
+      if(done == iov[i].iov_len){
+        i++;
+        done = 0;
+      }
+    }
+    if(off < 0)
+      f->off = o;
+    iunlock(f->ip);
+    end_op();
+
+    if(r != n1)
+      return -1;  // error from writei
+    tot += n;
+  }
+  myproc()->acct.wbytes += tot;
+  return tot;
+}
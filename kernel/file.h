@@ -3,6 +3,7 @@ struct file {
   int ref; // reference count
   char readable;
   char writable;
+  char nonblock;     // O_NONBLOCK: fail reads and writes that would wait
   struct pipe *pipe; // FD_PIPE
   struct inode *ip;  // FD_INODE and FD_DEVICE
   uint off;          // FD_INODE
@@ -31,11 +32,22 @@ struct inode {
 };
 
 // map major device number to device functions.
+struct pollent;
+
+// read's last argument says not to wait for input; it
+// returns -1 instead. poll is as for filepoll(), and may be 0
+// if the device never makes readers or writers wait.
 struct devsw {
-  int (*read)(int, uint64, int);
+  int (*read)(int, uint64, int, int);
   int (*write)(int, uint64, int);
+  int (*poll)(struct pollent*);
 };
 
 extern struct devsw devsw[];
 
 #define CONSOLE 1
+#define PROF    2  // sampling profiler, see prof.c
+#define TRACEDEV 3 // tracepoints, see trace.c
+#define IOSTATS 4  // file system and disk statistics, see iostat.c
+#define LOCKSTATDEV 5 // lock statistics, see lockstat.c
+#define MEMSTATS 6 // physical memory statistics, see memstat.c
@@ -44,6 +44,7 @@ fsinit(int dev) {
   if(sb.magic != FSMAGIC)
     panic("invalid file system");
   initlog(dev, &sb);
+  swapinit(&sb);
 }
 
 // ブロックを 0 クリアする
@@ -374,13 +375,26 @@ iunlock(struct inode *ip)
 // be recycled.
 // If that was the last reference and the inode has no links
 // to it, free the inode (and its content) on disk.
-// All calls to iput() must be inside a transaction in
-// case it has to free the inode.
+// Freeing the inode must be done inside a transaction, so
+// iput() starts one if it has to free the inode and the
+// caller isn't in one, as read-only operations aren't.
 void
 iput(struct inode *ip)
 {
   acquire(&itable.lock);
 
+  if(ip->ref == 1 && ip->valid && ip->nlink == 0 && !myproc()->logop){
+    // a read-only operation, such as exec(), runs outside
+    // any transaction, but freeing ip writes to the disk.
+    // start one, and look again, since someone may have
+    // found ip while begin_op() waited.
+    release(&itable.lock);
+    begin_op();
+    iput(ip);
+    end_op();
+    return;
+  }
+
   if(ip->ref == 1 && ip->valid && ip->nlink == 0){
     // 指定された inode の参照数が1であり、valid なとき
     // つまり、この iput により誰も使わなくなり、かつディスクから読み込んでいるとき
@@ -517,6 +531,7 @@ itrunc(struct inode *ip)
     ip->addrs[NDIRECT] = 0;
   }
 
+  pcdrop(ip, 0, ip->size);
   ip->size = 0;
   iupdate(ip);
 }
@@ -533,23 +548,15 @@ stati(struct inode *ip, struct stat *st)
   st->size = ip->size;
 }
 
-// Read data from inode.
-// Caller must hold ip->lock.
-// If user_dst==1, then dst is a user virtual address;
-// otherwise, dst is a kernel address.
-int
-readi(struct inode *ip, int user_dst, uint64 dst, uint off, uint n)
+// Read n bytes of ip's contents at off, which must all be
+// in the file, from its disk blocks.
+// Returns the number of bytes read, or -1 if a copy failed.
+static int
+readblocks(struct inode *ip, int user_dst, uint64 dst, uint off, uint n)
 {
   uint tot, m;
   struct buf *bp;
 
-  if(off > ip->size || off + n < off)
-    // オフセットが大きすぎたり、読み込みサイズが大きすぎるときはエラー
-    return 0;
-  if(off + n > ip->size)
-    // 読み込みサイズが終端を超えるときは縮める
-    n = ip->size - off;
-
   // m は前回ループで読み込んだデータ数、読み込み位置をずらしながらループしている
   for(tot=0; tot<n; tot+=m, off+=m, dst+=m){
     // オフセットをブロックサイズで割り、何番目のブロックが必要かを計算
@@ -574,6 +581,58 @@ readi(struct inode *ip, int user_dst, uint64 dst, uint off, uint n)
   return tot;
 }
 
+// Fill page with ip's contents from off, which must be
+// page-aligned, to the end of the page or the file,
+// whichever comes first. For the page cache.
+// Caller must hold ip->lock.
+// Returns 0 on success, -1 on failure.
+int
+ireadpage(struct inode *ip, char *page, uint off)
+{
+  uint n;
+
+  if(off >= ip->size)
+    return 0;
+  n = min(ip->size - off, PGSIZE);
+  return readblocks(ip, 0, (uint64)page, off, n) == n ? 0 : -1;
+}
+
+// Read data from inode, a page at a time through the
+// page cache.
+// Caller must hold ip->lock.
+// If user_dst==1, then dst is a user virtual address;
+// otherwise, dst is a kernel address.
+int
+readi(struct inode *ip, int user_dst, uint64 dst, uint off, uint n)
+{
+  uint tot, m;
+  uint64 pa;
+  int r;
+
+  if(off > ip->size || off + n < off)
+    // オフセットが大きすぎたり、読み込みサイズが大きすぎるときはエラー
+    return 0;
+  if(off + n > ip->size)
+    // 読み込みサイズが終端を超えるときは縮める
+    n = ip->size - off;
+
+  for(tot=0; tot<n; tot+=m, off+=m, dst+=m){
+    // このページに対して読み取るバイト数
+    m = min(n - tot, PGSIZE - off%PGSIZE);
+    if((pa = pcget(ip, PGROUNDDOWN(off))) == 0){
+      // the page cache is full of mapped pages.
+      if((r = readblocks(ip, user_dst, dst, off, m)) != m)
+        return r < 0 ? -1 : tot + r;
+      continue;
+    }
+    r = either_copyout(user_dst, dst, (char*)pa + off%PGSIZE, m);
+    pcput(pa);
+    if(r == -1)
+      return -1;
+  }
+  return tot;
+}
+
 // Write data to inode.
 // Caller must hold ip->lock.
 // If user_src==1, then src is a user virtual address;
@@ -608,6 +667,8 @@ writei(struct inode *ip, int user_src, uint64 src, uint off, uint n)
       break;
     }
     log_write(bp);
+    // keep any cached copy of the page up to date.
+    pcupdate(ip, off, (char*)bp->data + (off % BSIZE), m);
     brelse(bp);
   }
 
@@ -8,6 +8,7 @@
 // Disk layout:
 // [ boot block | super block | log | inode blocks |
 //                                          free bit map | data blocks]
+// followed, outside the file system, by the swap area (see swap.c).
 //
 // mkfs computes the super block and builds an initial file system. The
 // super block describes the disk layout:
@@ -20,9 +21,12 @@ struct superblock {
   uint logstart;     // Block number of first log block
   uint inodestart;   // Block number of first inode block
   uint bmapstart;    // Block number of first free map block
+  uint swapstart;    // Block number of first swap block
+  uint nswap;        // Number of pages of swap
 };
 
 #define FSMAGIC 0x10203040
+#define SWAPBPP 4          // blocks per page of swap (PGSIZE / BSIZE)
 
 #define NDIRECT 12
 #define NINDIRECT (BSIZE / sizeof(uint))
@@ -0,0 +1,37 @@
+//
+// The IOSTATS device. Each read returns a struct iostats
+// with the buffer cache's, the log's and the disk's counters
+// as they are now.
+//
+
+#include "types.h"
+#include "param.h"
+#include "riscv.h"
+#include "spinlock.h"
+#include "sleeplock.h"
+#include "fs.h"
+#include "file.h"
+#include "iostat.h"
+#include "defs.h"
+
+static int
+iostatread(int user_dst, uint64 dst, int n, int nonblock)
+{
+  struct iostats st;
+
+  if(n < sizeof(st))
+    return -1;
+  memset(&st, 0, sizeof(st));
+  bstats(&st);
+  logstats(&st);
+  diskstats(&st);
+  if(either_copyout(user_dst, dst, &st, sizeof(st)) < 0)
+    return -1;
+  return sizeof(st);
+}
+
+void
+iostatinit(void)
+{
+  devsw[IOSTATS].read = iostatread;
+}
@@ -0,0 +1,28 @@
+// File system and disk statistics since boot, as read from
+// the IOSTATS device. Times are in ticks of the time CSR.
+#define NIOHIST 24
+
+struct iostats {
+  // buffer cache, bio.c
+  uint64 bhits;         // bget() found the block cached
+  uint64 bmisses;       // bget() had to recycle a buffer
+  uint64 bevicts;       // ... that held another block's data
+
+  // log, log.c
+  uint64 ops;           // file system operations (begin_op())
+  uint64 commits;       // transactions committed
+  uint64 logblocks;     // blocks written by all commits
+  uint64 maxcommit;     // most blocks in one commit
+  uint64 absorbed;      // log_write()s of a block already in the log
+  uint64 committime;    // total time spent committing
+  uint64 maxcommittime;
+
+  // disk, virtio_disk.c
+  uint64 dreads;        // requests
+  uint64 dwrites;
+  uint64 dbytes;        // bytes transferred
+  uint64 dinflight;     // requests at the disk now
+  uint64 dmaxinflight;  // most requests at the disk at once
+  uint64 dtime;         // total time from submit to completion
+  uint64 dhist[NIOHIST]; // requests that took [2^i, 2^(i+1)) ticks
+};
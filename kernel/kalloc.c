@@ -7,10 +7,9 @@
 #include "memlayout.h"
 #include "spinlock.h"
 #include "riscv.h"
+#include "memstat.h"
 #include "defs.h"
 
-void freerange(void *pa_start, void *pa_end);
-
 extern char end[]; // first address after kernel.
                    // defined by kernel.ld.
 
@@ -21,29 +20,31 @@ struct run {
 struct {
   struct spinlock lock;
   struct run *freelist;
+  // pages from fresh up to PHYSTOP have never been allocated.
+  // kalloc() carves them off one at a time once the freelist
+  // is empty, so that booting doesn't have to touch every page
+  // of RAM.
+  char *fresh;
+  // pages that idle harts have zeroed ahead of time for
+  // kalloc_zeroed(), up to NZEROPAGE of them. kalloc() uses
+  // them too once the freelist and fresh pages run out.
+  struct run *zeroed;
+  int nzeroed;
+  uint64 nfree;           // pages on freelist
+  uint64 zhits, zmisses, zfills, zsteals;  // see struct memstats
 } kmem;
 
 void
 kinit()
 {
   initlock(&kmem.lock, "kmem");
-  freerange(end, (void*)PHYSTOP);
-}
-
-void
-freerange(void *pa_start, void *pa_end)
-{
-  char *p;
-  p = (char*)PGROUNDUP((uint64)pa_start);
-  // 指定された領域をページごとに区切って freelist に追加する
-  for(; p + PGSIZE <= (char*)pa_end; p += PGSIZE)
-    kfree(p);
+  kmem.fresh = (char*)PGROUNDUP((uint64)end);
 }
 
 // Free the page of physical memory pointed at by pa,
-// which normally should have been returned by a
-// call to kalloc().  (The exception is when
-// initializing the allocator; see kinit above.)
+// which should have been returned by a call to kalloc().
+// make MEMDEBUG=1 fills freed and newly allocated pages with
+// junk, to catch dangling references and uninitialized use.
 void
 kfree(void *pa)
 {
@@ -53,8 +54,10 @@ kfree(void *pa)
   if(((uint64)pa % PGSIZE) != 0 || (char*)pa < end || (uint64)pa >= PHYSTOP)
     panic("kfree");
 
+#ifdef MEMDEBUG
   // Fill with junk to catch dangling refs.
   memset(pa, 1, PGSIZE);
+#endif
 
   // 使っていないページをそのままリンクリストの要素としてつなげている
   r = (struct run*)pa;
@@ -63,9 +66,28 @@ kfree(void *pa)
   // 今までの先頭を r の next にし、先頭に r を追加する
   r->next = kmem.freelist;
   kmem.freelist = r;
+  kmem.nfree++;
   release(&kmem.lock);
 }
 
+// Take a page off the freelist, or a fresh one.
+// Caller holds kmem.lock.
+static struct run*
+kget(void)
+{
+  struct run *r;
+
+  // freelist の先頭から1ページ取り出す
+  if((r = kmem.freelist) != 0){
+    kmem.freelist = r->next;
+    kmem.nfree--;
+  } else if(kmem.fresh + PGSIZE <= (char*)PHYSTOP){
+    r = (struct run*)kmem.fresh;
+    kmem.fresh += PGSIZE;
+  }
+  return r;
+}
+
 // Allocate one 4096-byte page of physical memory.
 // Returns a pointer that the kernel can use.
 // Returns 0 if the memory cannot be allocated.
@@ -74,14 +96,90 @@ kalloc(void)
 {
   struct run *r;
 
-  acquire(&kmem.lock);
-  // freelist の先頭から1ページ取り出す
-  r = kmem.freelist;
-  if(r)
-    kmem.freelist = r->next;
-  release(&kmem.lock);
+  do {
+    acquire(&kmem.lock);
+    if((r = kget()) == 0 && (r = kmem.zeroed) != 0){
+      kmem.zeroed = r->next;
+      kmem.nzeroed--;
+      kmem.zsteals++;
+    }
+    release(&kmem.lock);
+    // out of memory: take back a page the page cache
+    // isn't using, or swap out a user page, and try again.
+  } while(r == 0 && (pcevict() || swapout()));
 
+#ifdef MEMDEBUG
   if(r)
     memset((char*)r, 5, PGSIZE); // fill with junk
+#endif
   return (void*)r;
 }
+
+// Allocate a page of zeroes, preferably one that an idle hart
+// zeroed ahead of time, so that the caller needn't.
+// Returns 0 if the memory cannot be allocated.
+void *
+kalloc_zeroed(void)
+{
+  struct run *r;
+
+  acquire(&kmem.lock);
+  if((r = kmem.zeroed) != 0){
+    kmem.zeroed = r->next;
+    kmem.nzeroed--;
+    kmem.zhits++;
+  } else {
+    kmem.zmisses++;
+  }
+  release(&kmem.lock);
+
+  if(r){
+    r->next = 0;  // the only word that wasn't zero
+    return (void*)r;
+  }
+  if((r = kalloc()) != 0)
+    memset((char*)r, 0, PGSIZE);
+  return (void*)r;
+}
+
+// Zero a free page for kalloc_zeroed(), unless NZEROPAGE are
+// ready already. Called by harts with nothing else to do.
+// Returns 1 if it zeroed a page.
+int
+kzerofill(void)
+{
+  struct run *r;
+
+  if(kmem.nzeroed >= NZEROPAGE)
+    return 0;
+  acquire(&kmem.lock);
+  r = kget();
+  release(&kmem.lock);
+  if(r == 0)
+    return 0;
+
+  memset((char*)r, 0, PGSIZE);
+
+  acquire(&kmem.lock);
+  r->next = kmem.zeroed;
+  kmem.zeroed = r;
+  kmem.nzeroed++;
+  kmem.zfills++;
+  release(&kmem.lock);
+  return 1;
+}
+
+// Fill in *st with the allocator's counters.
+void
+kmemstats(struct memstats *st)
+{
+  acquire(&kmem.lock);
+  st->free = kmem.nfree;
+  st->fresh = ((char*)PHYSTOP - kmem.fresh) / PGSIZE;
+  st->zeroed = kmem.nzeroed;
+  st->zhits = kmem.zhits;
+  st->zmisses = kmem.zmisses;
+  st->zfills = kmem.zfills;
+  st->zsteals = kmem.zsteals;
+  release(&kmem.lock);
+}
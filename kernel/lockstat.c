@@ -0,0 +1,159 @@
+//
+// Lock statistics. A kernel built with make LOCKSTAT=1 keeps,
+// for all the locks that share a name, how often they were
+// acquired and had to wait for, how long they were waited for
+// and held, and which callers of acquire() held them longest.
+// initlock() and initsleeplock() look up the lock's name in a
+// table of NLOCKSTAT classes; locks whose name doesn't fit go
+// uncounted.
+//
+// Each hart counts in its own copy of a class's statistics,
+// with interrupts off, so counting takes no lock and no atomic
+// instructions. Reading the LOCKSTAT device adds the copies
+// up, one struct lockstat per class, and writing anything to
+// it starts the counts over.
+//
+
+#include "types.h"
+#include "param.h"
+#include "riscv.h"
+#include "spinlock.h"
+#include "sleeplock.h"
+#include "fs.h"
+#include "file.h"
+#include "lockstat.h"
+#include "defs.h"
+
+struct lockclass {
+  char name[16];
+  int sleep;
+  struct lockstat cpu[NCPU];
+};
+
+static struct {
+  // never passed to initlock(), so not counted itself.
+  struct spinlock lock;
+  int n;
+  struct lockclass class[NLOCKSTAT];
+} locks = { .lock = { .name = "lockstat" } };
+
+// Find or make the class for locks named name.
+struct lockclass*
+lockclass(char *name, int sleep)
+{
+  struct lockclass *c;
+
+  acquire(&locks.lock);
+  for(c = locks.class; c < locks.class + locks.n; c++){
+    if(c->sleep == sleep && strncmp(c->name, name, sizeof(c->name)) == 0){
+      release(&locks.lock);
+      return c;
+    }
+  }
+  if(locks.n == NLOCKSTAT){
+    release(&locks.lock);
+    return 0;
+  }
+  c = &locks.class[locks.n];
+  safestrcpy(c->name, name, sizeof(c->name));
+  c->sleep = sleep;
+  __sync_synchronize();
+  locks.n++;
+  release(&locks.lock);
+  return c;
+}
+
+// Remember that pc held a lock for hold, if that is among
+// the NLOCKPC longest holds in st.
+static void
+holder(struct lockstat *st, uint64 pc, uint64 hold)
+{
+  int i, min = 0;
+
+  for(i = 0; i < NLOCKPC; i++){
+    if(st->pc[i] == pc){
+      if(hold > st->pchold[i])
+        st->pchold[i] = hold;
+      return;
+    }
+    if(st->pchold[i] < st->pchold[min])
+      min = i;
+  }
+  if(hold > st->pchold[min]){
+    st->pc[min] = pc;
+    st->pchold[min] = hold;
+  }
+}
+
+// A lock of class c that pc acquired, after waiting for wait
+// if it was contended, has been held for hold and is about
+// to be released. Interrupts must be off.
+void
+lockacct(struct lockclass *c, int contended, uint64 wait, uint64 pc, uint64 hold)
+{
+  struct lockstat *st = &c->cpu[cpuid()];
+
+  st->acquires++;
+  if(contended){
+    st->contended++;
+    st->wait += wait;
+  }
+  st->hold += hold;
+  if(hold > st->maxhold)
+    st->maxhold = hold;
+  holder(st, pc, hold);
+}
+
+// Return one struct lockstat for each class, as many as fit.
+static int
+lockstatread(int user_dst, uint64 dst, int n, int nonblock)
+{
+  struct lockstat st;
+  struct lockclass *c;
+  int i, nclass, got = 0;
+
+  nclass = locks.n;
+  __sync_synchronize();
+  for(c = locks.class; c < locks.class + nclass; c++){
+    if(n - got < sizeof(st))
+      break;
+    memset(&st, 0, sizeof(st));
+    safestrcpy(st.name, c->name, sizeof(st.name));
+    st.sleep = c->sleep;
+    for(i = 0; i < NCPU; i++){
+      struct lockstat *s = &c->cpu[i];
+      st.acquires += s->acquires;
+      st.contended += s->contended;
+      st.wait += s->wait;
+      st.hold += s->hold;
+      if(s->maxhold > st.maxhold)
+        st.maxhold = s->maxhold;
+      for(int j = 0; j < NLOCKPC; j++)
+        if(s->pchold[j])
+          holder(&st, s->pc[j], s->pchold[j]);
+    }
+    if(either_copyout(user_dst, dst + got, &st, sizeof(st)) < 0)
+      return -1;
+    got += sizeof(st);
+  }
+  return got;
+}
+
+// Start the counts over. A hart that is counting at the same
+// time may leave a few of its counts behind.
+static int
+lockstatwrite(int user_src, uint64 src, int n)
+{
+  int nclass = locks.n;
+
+  for(int i = 0; i < nclass; i++)
+    memset(locks.class[i].cpu, 0, sizeof(locks.class[i].cpu));
+  return n;
+}
+
+void
+lockstatinit(void)
+{
+  devsw[LOCKSTATDEV].read = lockstatread;
+  devsw[LOCKSTATDEV].write = lockstatwrite;
+}
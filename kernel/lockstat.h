@@ -0,0 +1,17 @@
+// Lock statistics, by lock name, as read from the LOCKSTAT
+// device of a kernel built with make LOCKSTAT=1. Times are in
+// ticks of the time CSR.
+#define NLOCKSTAT 64   // lock names tracked
+#define NLOCKPC   4    // longest holders kept for each
+
+struct lockstat {
+  char name[16];
+  int sleep;              // sleeplocks rather than spinlocks?
+  uint64 acquires;
+  uint64 contended;       // acquisitions that had to wait
+  uint64 wait;            // total time spent waiting
+  uint64 hold;            // total time held
+  uint64 maxhold;         // longest time held
+  uint64 pc[NLOCKPC];     // callers that held it longest,
+  uint64 pchold[NLOCKPC]; // and how long each did
+};
@@ -1,11 +1,14 @@
 #include "types.h"
 #include "riscv.h"
+#include "trace.h"
+#include "iostat.h"
 #include "defs.h"
 #include "param.h"
 #include "spinlock.h"
 #include "sleeplock.h"
 #include "fs.h"
 #include "buf.h"
+#include "proc.h"
 
 // Simple logging that allows concurrent FS system calls.
 //
@@ -46,8 +49,18 @@ struct log {
   int size;
   int outstanding; // how many FS sys calls are executing.
   int committing;  // in commit(), please wait.
+  uint64 seq;      // number of the transaction ops are joining
+  uint64 committed; // number of the last transaction committed
   int dev;
   struct logheader lh;
+
+  uint64 ops;           // see struct iostats
+  uint64 commits;
+  uint64 blocks;
+  uint64 maxcommit;
+  uint64 absorbed;
+  uint64 committime;
+  uint64 maxcommittime;
 };
 struct log log;
 
@@ -66,6 +79,7 @@ initlog(int dev, struct superblock *sb)
   log.start = sb->logstart;
   log.size = sb->nlog;
   log.dev = dev;
+  log.seq = 1;
   // 電源断などでコミット済みのトランザクションが残っていた場合に備え、最初に復帰処理を実施
   recover_from_log();
 }
@@ -174,7 +188,10 @@ begin_op(void)
       // 処理中の(FS システムコールを呼んでいる)プロセス数をひとつ増やし、ロックを開放してから抜ける
       // あとで outstanding なプロセスが 0 になったらまとめて commit することになる
       log.outstanding += 1;
+      log.ops++;
       release(&log.lock);
+      myproc()->logop = 1;
+      TRACE(TR_BEGINOP, 0, 0);
       break;
     }
   }
@@ -187,8 +204,11 @@ begin_op(void)
 void
 end_op(void)
 {
-  int do_commit = 0;
+  int do_commit = 0, n;
+  uint64 t, seq = 0;
 
+  TRACE(TR_ENDOP, 0, 0);
+  myproc()->logop = 0;
   acquire(&log.lock);
   log.outstanding -= 1;
   if(log.committing)
@@ -198,6 +218,7 @@ end_op(void)
     // ブロックキャッシュにアクセスしているプロセスがいなくなったのでコミットする(フラグを立てる)
     do_commit = 1;
     log.committing = 1;
+    seq = log.seq++;
   } else {
     // 処理中のプロセス数が減ったので begin_op で待っているプロセスがいたら起こす
     // begin_op() may be waiting for log space,
@@ -210,15 +231,51 @@ end_op(void)
   if(do_commit){
     // call commit w/o holding locks, since not allowed
     // to sleep with locks.
+    n = log.lh.n;
+    t = r_time();
     commit();
+    t = r_time() - t;
     acquire(&log.lock);
+    if(n > 0){
+      log.commits++;
+      log.blocks += n;
+      if(n > log.maxcommit)
+        log.maxcommit = n;
+      log.committime += t;
+      if(t > log.maxcommittime)
+        log.maxcommittime = t;
+    }
     log.committing = 0;
+    log.committed = seq;
     // begin_op にコミットを待っているプロセスがいたら起こす
+    // (log_sync() も)
     wakeup(&log);
     release(&log.lock);
   }
 }
 
+// Wait until every FS system call that has already returned
+// is on disk. Its updates are in the transaction that ops are
+// joining, if any are still running, or in the one being
+// committed; that one ends when the last op leaves it.
+// Must not be called inside begin_op()/end_op().
+void
+log_sync(void)
+{
+  uint64 seq;
+
+  acquire(&log.lock);
+  if(log.committing)
+    seq = log.seq - 1;
+  else if(log.outstanding > 0)
+    seq = log.seq;
+  else
+    seq = log.committed;
+  while(log.committed < seq)
+    sleep(&log, &log.lock);
+  release(&log.lock);
+}
+
 // ログブロックの1番目(0オリジン)以降に、変更されたブロックのキャッシュを書き込む
 // キャッシュをいきなりストレージ内の本物のブロックには書き込まず
 // 一度ログブロックと呼ばれる部分に書き出すところが大事
@@ -255,6 +312,7 @@ commit()
 {
   if (log.lh.n > 0) {
     // ログが1つでもあったら実行
+    TRACE(TR_COMMIT, log.lh.n, 0);
 
     // ログブロックの1番目(0オリジン)以降に、変更されたブロックのキャッシュを書き込む
     write_log();     // Write modified blocks from cache to log
@@ -308,6 +366,8 @@ log_write(struct buf *b)
     if (log.lh.block[i] == b->blockno)   // log absorption
       break;
   }
+  if (i < log.lh.n)
+    log.absorbed++;
   log.lh.block[i] = b->blockno;
   if (i == log.lh.n) {  // Add new block to log?
     // 新しいブロックをトランザクションに加える場合は、そのブロックのキャッシュをピン止めする
@@ -319,3 +379,17 @@ log_write(struct buf *b)
   release(&log.lock);
 }
 
+// Add the log's statistics to *st.
+void
+logstats(struct iostats *st)
+{
+  acquire(&log.lock);
+  st->ops = log.ops;
+  st->commits = log.commits;
+  st->logblocks = log.blocks;
+  st->maxcommit = log.maxcommit;
+  st->absorbed = log.absorbed;
+  st->committime = log.committime;
+  st->maxcommittime = log.maxcommittime;
+  release(&log.lock);
+}
@@ -4,16 +4,51 @@
 #include "riscv.h"
 #include "defs.h"
 
+// 1 once hart 0 has set up the kernel page table, 2 once
+// initialization is complete.
 volatile static int started = 0;
 
+// Initialization that may run on any hart, in any order, once
+// the kernel page table is up. Each hart takes the next one
+// until all are taken, so that the other harts help hart 0
+// instead of spinning.
+static void (*inits[])(void) = {
+  procinit,        // process table
+  trapinit,        // trap vectors
+  plicinit,        // set up interrupt controller
+  binit,           // buffer cache
+  pcinit,          // page cache
+  iinit,           // inode table
+  fileinit,        // file table
+  profinit,        // profiler device
+  traceinit,       // trace device
+  iostatinit,      // I/O statistics device
+  memstatinit,     // memory statistics device
+  lockstatinit,    // lock statistics device
+  virtio_disk_init, // emulated hard disk
+};
+volatile static int ninit;     // next in inits to take
+volatile static int ninitdone; // how many have finished
+
+static void
+runinits(void)
+{
+  int i;
+
+  while((i = __sync_fetch_and_add(&ninit, 1)) < NELEM(inits)){
+    inits[i]();
+    __sync_fetch_and_add(&ninitdone, 1);
+  }
+}
+
 // start.c/start から mret で main に "戻ってくる" ので、
 // OS のメイン初期化処理はスーパーバイザモードで実行されることになる
 // start() jumps here in supervisor mode on all CPUs.
 void
 main()
 {
-  // main にはすべての cpu はジャンプしてくるが、初期化処理を行うのは
-  // cpuid が 0 のものひとつだけ
+  // main にはすべての cpu はジャンプしてくるが、初期化処理の大半を行うのは
+  // cpuid が 0 のもの。ほかの cpu は inits[] を手伝う
   if(cpuid() == 0){
     // コンソール(uart)を初期化
     consoleinit();
@@ -23,33 +58,27 @@ main()
     printf("xv6 kernel is booting\n");
     printf("\n");
 
-    // 物理メモリを freelist にすべてつなげる
     kinit();         // physical page allocator
+    kmallocinit();   // small object allocator
     // デバイスやカーネルの動作に必要なページを登録する
     // ここまではページングが無効なので直接物理アドレスにアクセスできている
     kvminit();       // create kernel page table
     // この CPU のページングを有効にする
     kvminithart();   // turn on paging
+    __sync_synchronize();
+    started = 1;
 
-    // プロセス構造体の初期化
-    procinit();      // process table
-    // トラップ用のロックの初期化だけ
-    trapinit();      // trap vectors
     // トラップベクタ(stvec)を設定する
     trapinithart();  // install kernel trap vector
-
-    // plic のレジスタを操作し割込みの優先度を設定
-    plicinit();      // set up interrupt controller
     // 割込み許可レジスタを設定(RISC-V では CPU コアごとに設定される)
     plicinithart();  // ask PLIC for device interrupts
-
-    binit();         // buffer cache
-    iinit();         // inode table
-    fileinit();      // file table
-    virtio_disk_init(); // emulated hard disk
+    runinits();
+    while(ninitdone < NELEM(inits))
+      ;
+    __sync_synchronize();
     userinit();      // first user process
     __sync_synchronize();
-    started = 1;
+    started = 2;
   } else {
     while(started == 0)
       ;
@@ -58,8 +87,13 @@ main()
     kvminithart();    // turn on paging
     trapinithart();   // install kernel trap vector
     plicinithart();   // ask PLIC for device interrupts
+    runinits();
+    while(started < 2)
+      ;
+    __sync_synchronize();
   }
+  __sync_fetch_and_add(&vdso->ncpu, 1);
 
   // 各 CPU コアで実行され、ここには戻らない
-  scheduler();        
+  scheduler();
 }
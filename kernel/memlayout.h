@@ -30,6 +30,9 @@
 #define CLINT_MTIMECMP(hartid) (CLINT + 0x4000 + 8*(hartid))
 #define CLINT_MTIME (CLINT + 0xBFF8) // cycles since boot.
 
+// frequency of CLINT_MTIME, which the time CSR reads too.
+#define TIMEBASE 10000000L
+
 // qemu puts platform-level interrupt controller (PLIC) here.
 #define PLIC 0x0c000000L
 #define PLIC_PRIORITY (PLIC + 0x0)
@@ -51,9 +54,11 @@
 // in both user and kernel space.
 #define TRAMPOLINE (MAXVA - PGSIZE)
 
-// map kernel stacks beneath the trampoline,
-// each surrounded by invalid guard pages.
-#define KSTACK(p) (TRAMPOLINE - ((p)+1)* 2*PGSIZE)
+// kernel stacks, one for each struct proc that has ever been
+// made, each below an invalid guard page. they sit in the
+// gigabyte below the trampoline's, whose page-table entry
+// SHAREDPT process page tables share with the kernel's.
+#define KSTACK(i) (MAXVA - (1L << 30) - ((i)+1)* 2*PGSIZE)
 
 // User memory layout.
 // Address zero first:
@@ -62,6 +67,36 @@
 //   fixed-size stack
 //   expandable heap
 //   ...
+//   URING (struct ring, if the process called ringsetup())
+//   VDSO (struct vdso, read-only, shared by all processes)
+//   USYSCALL (struct usyscall, read-only)
 //   TRAPFRAME (p->trapframe, used by the trampoline)
 //   TRAMPOLINE (the same page as in the kernel)
 #define TRAPFRAME (TRAMPOLINE - PGSIZE)
+#define USYSCALL (TRAPFRAME - PGSIZE)
+#define VDSO (USYSCALL - PGSIZE)
+#define URING (VDSO - PGSIZE)
+
+#ifndef __ASSEMBLER__
+// kernel data that user code can read without a system
+// call; see uptime() and getpid() in user/ulib.c.
+struct vdso {
+  volatile uint64 ticks;  // timer interrupts since boot
+  uint64 timebase;        // frequency of the time CSR, in Hz
+  volatile uint64 ncpu;   // harts that have started
+};
+
+struct usyscall {
+  int pid;                // process ID
+};
+#endif
+
+// user memory must stay below MAXUVA.
+#ifdef SHAREDPT
+// every process page table also maps the kernel, including
+// the devices, which sit in the same gigabyte as user memory
+// (see kvmshare() in vm.c).
+#define MAXUVA PLIC
+#else
+#define MAXUVA URING
+#endif
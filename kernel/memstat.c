@@ -0,0 +1,34 @@
+//
+// The MEMSTATS device. Each read returns a struct memstats
+// with the physical page allocator's counters as they are now.
+//
+
+#include "types.h"
+#include "param.h"
+#include "riscv.h"
+#include "spinlock.h"
+#include "sleeplock.h"
+#include "fs.h"
+#include "file.h"
+#include "memstat.h"
+#include "defs.h"
+
+static int
+memstatread(int user_dst, uint64 dst, int n, int nonblock)
+{
+  struct memstats st;
+
+  if(n < sizeof(st))
+    return -1;
+  memset(&st, 0, sizeof(st));
+  kmemstats(&st);
+  if(either_copyout(user_dst, dst, &st, sizeof(st)) < 0)
+    return -1;
+  return sizeof(st);
+}
+
+void
+memstatinit(void)
+{
+  devsw[MEMSTATS].read = memstatread;
+}
@@ -0,0 +1,14 @@
+// Physical memory allocator statistics, as read from the
+// MEMSTATS device. Counts are of pages.
+
+struct memstats {
+  uint64 free;          // on the free list
+  uint64 fresh;         // never allocated since boot
+  uint64 zeroed;        // zeroed ahead of time, ready for kalloc_zeroed()
+
+  // since boot:
+  uint64 zhits;         // kalloc_zeroed() found a page zeroed ahead of time
+  uint64 zmisses;       // ... had to zero one itself
+  uint64 zfills;        // pages zeroed by idle harts
+  uint64 zsteals;       // zeroed pages kalloc() took, out of other memory
+};
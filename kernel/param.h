@@ -1,13 +1,23 @@
-#define NPROC        64  // maximum number of processes
+#define NPROC      4096  // maximum number of processes
+#define NKSTACKFREE  64  // unused process structures that keep a kernel stack
 #define NCPU          8  // maximum number of CPUs
-#define NOFILE       16  // open files per process
-#define NFILE       100  // open files per system
+#define NOFILE       16  // open files per process before its table grows
+#define MAXFD       512  // maximum open files per process
 #define NINODE       50  // maximum number of active i-nodes
 #define NDEV         10  // maximum major device number
 #define ROOTDEV       1  // device number of file system root disk
 #define MAXARG       32  // max exec arguments
+#define MAXUSTACK   256  // max pages a user stack may grow to
+#define MAXSPAWNFA   32  // max file actions per spawn
 #define MAXOPBLOCKS  10  // max # of blocks any FS op writes
 #define LOGSIZE      (MAXOPBLOCKS*3)  // max data blocks in on-disk log
 #define NBUF         (MAXOPBLOCKS*3)  // size of disk block cache
+#define NPCACHE      1024  // size of page cache, in pages
+#define NZEROPAGE    256   // pages idle harts keep zeroed ahead of time
 #define FSSIZE       2000  // size of file system in blocks
+#define SWAPSIZE     16384 // size of swap area after it, in pages
+#define GROWSTEP     (1024*1024) // sbrk() grows memory this much at a time
 #define MAXPATH      128   // maximum file path name
+#define MAXIOV       16    // max buffers per readv/writev
+#define NSYSCALL     40    // size of system call tables; > highest SYS_ number
+#define NHPM         4     // HPM counters a process can program (3 through 6)
@@ -0,0 +1,322 @@
+//
+// Page cache: whole pages of file contents.
+//
+// readi() copies file data out of the page cache a page at a
+// time, reading a page's blocks in only when it isn't cached,
+// and exec() maps a program's text from it into every process
+// running the program. The buffer cache in bio.c still holds
+// metadata, and file data on its way to disk: writei() writes
+// through it and the log as before, then updates the cached
+// page.
+//
+// A cached page is named by its file's device and inode
+// number and a page-aligned offset in the file. Its ref
+// counts the page table entries that map it, which carry
+// PTE_S, and readi() calls that are copying from it. A page
+// whose ref falls to zero stays in the cache, on an LRU list,
+// until its slot or its memory is needed for something else.
+//
+// A page that processes have mapped must not change under
+// them, so writei() drops it from the cache instead of
+// updating it, as itrunc() does with all of a file's pages.
+// A dropped page keeps its old contents until the last
+// process using it lets go, the way an unlinked file lives
+// on while it is open.
+//
+
+#include "types.h"
+#include "param.h"
+#include "memlayout.h"
+#include "riscv.h"
+#include "spinlock.h"
+#include "sleeplock.h"
+#include "fs.h"
+#include "file.h"
+#include "defs.h"
+
+#define NPCHASH 257
+
+struct pcpage {
+  uint dev;
+  uint inum;
+  uint off;               // offset in file, page-aligned
+  char *data;             // the page itself
+  int ref;                // mappings of data
+  int named;              // on the name hash?
+  struct pcpage *next;    // name hash chain
+  struct pcpage *panext;  // address hash chain
+  struct pcpage *lrunext; // unused pages, most recently used first
+  struct pcpage *lruprev;
+};
+
+struct {
+  struct spinlock lock;
+  struct pcpage page[NPCACHE];
+  struct pcpage *free;            // slots without a page, linked by next
+  struct pcpage *name[NPCHASH];   // by dev, inum and off
+  struct pcpage *addr[NPCHASH];   // by data, for pcdup() and pcput()
+  struct pcpage *lru;             // unused pages, head of LRU list
+  struct pcpage *lrutail;
+} pcache;
+
+void
+pcinit(void)
+{
+  struct pcpage *pg;
+
+  initlock(&pcache.lock, "pcache");
+  for(pg = pcache.page; pg < pcache.page + NPCACHE; pg++){
+    pg->next = pcache.free;
+    pcache.free = pg;
+  }
+}
+
+static struct pcpage**
+namehash(uint dev, uint inum, uint off)
+{
+  return &pcache.name[(dev*31 + inum*17 + off/PGSIZE) % NPCHASH];
+}
+
+static struct pcpage**
+addrhash(uint64 pa)
+{
+  return &pcache.addr[(pa/PGSIZE) % NPCHASH];
+}
+
+static void
+lrulink(struct pcpage *pg)
+{
+  pg->lruprev = 0;
+  pg->lrunext = pcache.lru;
+  if(pcache.lru)
+    pcache.lru->lruprev = pg;
+  else
+    pcache.lrutail = pg;
+  pcache.lru = pg;
+}
+
+static void
+lruunlink(struct pcpage *pg)
+{
+  if(pg->lruprev)
+    pg->lruprev->lrunext = pg->lrunext;
+  else
+    pcache.lru = pg->lrunext;
+  if(pg->lrunext)
+    pg->lrunext->lruprev = pg->lruprev;
+  else
+    pcache.lrutail = pg->lruprev;
+}
+
+// Take pg off the name hash.
+static void
+unname(struct pcpage *pg)
+{
+  struct pcpage **pp;
+
+  for(pp = namehash(pg->dev, pg->inum, pg->off); *pp; pp = &(*pp)->next){
+    if(*pp == pg){
+      *pp = pg->next;
+      break;
+    }
+  }
+  pg->named = 0;
+}
+
+static struct pcpage*
+findaddr(uint64 pa)
+{
+  struct pcpage *pg;
+
+  for(pg = *addrhash(pa); pg; pg = pg->panext)
+    if((uint64)pg->data == pa)
+      return pg;
+  panic("pcache: not a cached page");
+}
+
+// Forget pg, whose ref is zero, and return its page,
+// which the caller must reuse or kfree().
+// Caller must hold pcache.lock.
+static char*
+pcforget(struct pcpage *pg)
+{
+  struct pcpage **pp;
+  char *data;
+
+  if(pg->named)
+    unname(pg);
+  for(pp = addrhash((uint64)pg->data); *pp != pg; pp = &(*pp)->panext)
+    ;
+  *pp = pg->panext;
+  data = pg->data;
+  pg->data = 0;
+  pg->next = pcache.free;
+  pcache.free = pg;
+  return data;
+}
+
+// Evict the least recently used page that nothing maps,
+// and give its memory back to kalloc(). kalloc() calls
+// this when it runs out. Returns 0 if there was no page
+// to evict.
+int
+pcevict(void)
+{
+  struct pcpage *pg;
+  char *data;
+
+  acquire(&pcache.lock);
+  if((pg = pcache.lrutail) == 0){
+    release(&pcache.lock);
+    return 0;
+  }
+  lruunlink(pg);
+  data = pcforget(pg);
+  release(&pcache.lock);
+  kfree(data);
+  return 1;
+}
+
+// Return the physical address of the page holding ip's
+// contents at off, which must be page-aligned, with a
+// reference that the caller must map or pcput(). Bytes past
+// the end of the file read as zeros. Returns 0 if the page
+// cannot be had. Caller must hold ip->lock, which keeps
+// anyone else from reading this page in at the same time.
+uint64
+pcget(struct inode *ip, uint off)
+{
+  struct pcpage *pg;
+  char *data = 0;
+
+  acquire(&pcache.lock);
+  for(pg = *namehash(ip->dev, ip->inum, off); pg; pg = pg->next){
+    if(pg->dev == ip->dev && pg->inum == ip->inum && pg->off == off){
+      if(pg->ref++ == 0)
+        lruunlink(pg);
+      release(&pcache.lock);
+      return (uint64)pg->data;
+    }
+  }
+
+  // not cached. find a slot, evicting the least recently
+  // used unmapped page if every slot is taken.
+  if((pg = pcache.free) != 0){
+    pcache.free = pg->next;
+  } else if((pg = pcache.lrutail) != 0){
+    lruunlink(pg);
+    data = pcforget(pg);
+    pcache.free = pg->next;
+  } else {
+    release(&pcache.lock);
+    return 0;
+  }
+  release(&pcache.lock);
+
+  if(data == 0 && (data = kalloc()) == 0)
+    goto bad;
+  memset(data, 0, PGSIZE);
+  if(ireadpage(ip, data, off) < 0)
+    goto bad;
+
+  acquire(&pcache.lock);
+  pg->dev = ip->dev;
+  pg->inum = ip->inum;
+  pg->off = off;
+  pg->data = data;
+  pg->ref = 1;
+  pg->named = 1;
+  pg->next = *namehash(ip->dev, ip->inum, off);
+  *namehash(ip->dev, ip->inum, off) = pg;
+  pg->panext = *addrhash((uint64)data);
+  *addrhash((uint64)data) = pg;
+  release(&pcache.lock);
+  return (uint64)data;
+
+ bad:
+  if(data)
+    kfree(data);
+  acquire(&pcache.lock);
+  pg->next = pcache.free;
+  pcache.free = pg;
+  release(&pcache.lock);
+  return 0;
+}
+
+// Take another reference to the cached page at pa.
+void
+pcdup(uint64 pa)
+{
+  acquire(&pcache.lock);
+  findaddr(pa)->ref++;
+  release(&pcache.lock);
+}
+
+// Give back a reference from pcget() or pcdup().
+void
+pcput(uint64 pa)
+{
+  struct pcpage *pg;
+  char *data = 0;
+
+  acquire(&pcache.lock);
+  pg = findaddr(pa);
+  if(--pg->ref == 0){
+    if(pg->named)
+      lrulink(pg);
+    else
+      data = pcforget(pg);
+  }
+  release(&pcache.lock);
+  if(data)
+    kfree(data);
+}
+
+// Drop ip's cached pages that hold bytes off through
+// off+n-1, because they are about to change.
+// Caller must hold ip->lock.
+void
+pcdrop(struct inode *ip, uint off, uint n)
+{
+  struct pcpage *pg;
+  uint a;
+
+  acquire(&pcache.lock);
+  for(a = PGROUNDDOWN(off); a < off + n; a += PGSIZE){
+    for(pg = *namehash(ip->dev, ip->inum, a); pg; pg = pg->next){
+      if(pg->dev == ip->dev && pg->inum == ip->inum && pg->off == a){
+        if(pg->ref == 0){
+          lruunlink(pg);
+          kfree(pcforget(pg));
+        } else {
+          unname(pg);
+        }
+        break;
+      }
+    }
+  }
+  release(&pcache.lock);
+}
+
+// n bytes of ip's contents at off, all in one page, have
+// just been written from src. Update the cached copy of
+// that page, if there is one.
+// Caller must hold ip->lock.
+void
+pcupdate(struct inode *ip, uint off, char *src, uint n)
+{
+  struct pcpage *pg;
+  uint a = PGROUNDDOWN(off);
+
+  acquire(&pcache.lock);
+  for(pg = *namehash(ip->dev, ip->inum, a); pg; pg = pg->next){
+    if(pg->dev == ip->dev && pg->inum == ip->inum && pg->off == a){
+      if(pg->ref == 0)
+        memmove(pg->data + (off - a), src, n);
+      else
+        unname(pg);
+      break;
+    }
+  }
+  release(&pcache.lock);
+}
@@ -0,0 +1,138 @@
+//
+// Per-process performance counters.
+//
+// Every hart counts cycles, retired instructions, and the
+// events that mhpmevent3 through mhpmevent6 select, and
+// start.c lets user code read the counters directly. A
+// process that calls perfopen() also gets counts of just its
+// own execution: the scheduler calls perfin() when it starts
+// running the process and perfout() when the process stops,
+// and the differences in the counters accumulate in the
+// process's struct perf. perfopen() also chooses the events
+// the HPM counters count while the process runs; perfin()
+// loads them into the hart if they differ from what it has.
+//
+// Supervisor mode can read the counters but can't write the
+// event selectors, so hpmsetevents() asks timervec, in
+// machine mode, to do it.
+//
+
+#include "types.h"
+#include "param.h"
+#include "memlayout.h"
+#include "riscv.h"
+#include "spinlock.h"
+#include "proc.h"
+#include "perf.h"
+#include "defs.h"
+
+extern uint64 timer_scratch[NCPU][5+NHPM];
+
+// The events each hart's mhpmevent3.. hold. start() sets
+// them all to 0.
+static uint64 hartevent[NCPU][NHPM];
+
+// Load ev into this hart's event selectors.
+// Interrupts must be off.
+static void
+hpmsetevents(uint64 *ev)
+{
+  int id = cpuid();
+
+  if(memcmp(hartevent[id], ev, sizeof(hartevent[id])) == 0)
+    return;
+  memmove(&timer_scratch[id][5], ev, NHPM*sizeof(uint64));
+  memmove(hartevent[id], ev, sizeof(hartevent[id]));
+  asm volatile("ecall" : : : "memory");
+}
+
+static void
+readctrs(uint64 *v)
+{
+  int i;
+
+  v[PERF_CYCLE] = r_cycle();
+  v[PERF_INSTRET] = r_instret();
+  for(i = 0; i < NHPM; i++)
+    v[PERF_HPM+i] = r_hpmcounter(3+i);
+}
+
+// p is about to run on this hart. Called by the scheduler
+// with p->lock held.
+void
+perfin(struct proc *p)
+{
+  hpmsetevents(p->perf->event);
+  readctrs(p->perf->start);
+}
+
+// p has stopped running on this hart.
+void
+perfout(struct proc *p)
+{
+  uint64 now[NPERFCTR];
+  int i;
+
+  readctrs(now);
+  for(i = 0; i < NPERFCTR; i++)
+    p->perf->count[i] += now[i] - p->perf->start[i];
+}
+
+// perfopen(events, n): count events[0..n-1] with the HPM
+// counters, and start counting for this process alone. The
+// counts start from zero. Events are numbered as the
+// hardware numbers them.
+uint64
+sys_perfopen(void)
+{
+  struct proc *p = myproc();
+  struct perf *pf;
+  uint64 addr, ev[NHPM];
+  int n;
+
+  argaddr(0, &addr);
+  argint(1, &n);
+  if(n < 0 || n > NHPM)
+    return -1;
+  memset(ev, 0, sizeof(ev));
+  if(n > 0 && copyin(p->pagetable, (char*)ev, addr, n*sizeof(uint64)) < 0)
+    return -1;
+  if((pf = p->perf) == 0 && (pf = kmalloc(sizeof(*pf))) == 0)
+    return -1;
+  memmove(pf->event, ev, sizeof(ev));
+  memset(pf->count, 0, sizeof(pf->count));
+
+  // p is running on this hart, so do what perfin() would
+  // have done, before the scheduler can call perfout().
+  push_off();
+  hpmsetevents(pf->event);
+  readctrs(pf->start);
+  p->perf = pf;
+  pop_off();
+  return 0;
+}
+
+// perfread(v, n): copy this process's counts since
+// perfopen() into v[0..n-1], indexed by PERF_*.
+uint64
+sys_perfread(void)
+{
+  struct proc *p = myproc();
+  uint64 addr, v[NPERFCTR], now[NPERFCTR];
+  int n, i;
+
+  argaddr(0, &addr);
+  argint(1, &n);
+  if(p->perf == 0 || n < 0)
+    return -1;
+  if(n > NPERFCTR)
+    n = NPERFCTR;
+  push_off();
+  readctrs(now);
+  for(i = 0; i < NPERFCTR; i++)
+    v[i] = p->perf->count[i] + now[i] - p->perf->start[i];
+  pop_off();
+  if(copyout(p->pagetable, addr, (char*)v, n*sizeof(uint64)) < 0)
+    return -1;
+  return n;
+}
@@ -0,0 +1,24 @@
+// Counters that perfread() returns, counting only while the
+// calling process runs.
+#define PERF_CYCLE    0  // cycles
+#define PERF_INSTRET  1  // instructions retired
+#define PERF_HPM      2  // first of NHPM counters of events from perfopen()
+#define NPERFCTR      (PERF_HPM + NHPM)
+
+// A process's counts; see perf.c.
+struct perf {
+  uint64 event[NHPM];       // events for mhpmevent3.. while it runs
+  uint64 start[NPERFCTR];   // counter values when it last started running
+  uint64 count[NPERFCTR];   // counts while it ran, up to start
+};
+
+// A region of a user program timed with perfbegin() and
+// perfend(); see user/perf.c.
+struct perfregion {
+  char *name;
+  uint64 n;                 // times through the region
+  uint64 time;              // total time CSR ticks in it
+  uint64 total[NPERFCTR];   // total counts in it
+  uint64 t0;                // at the last perfbegin()
+  uint64 start[NPERFCTR];
+};
@@ -7,6 +7,7 @@
 #include "fs.h"
 #include "sleeplock.h"
 #include "file.h"
+#include "poll.h"
 
 #define PIPESIZE 512
 
@@ -17,6 +18,7 @@ struct pipe {
   uint nwrite;    // number of bytes written
   int readopen;   // read fd is still open
   int writeopen;  // write fd is still open
+  struct pollq pq; // processes polling either end
 };
 
 // パイプを新しく作成し、引数としてもらった2つの引数の参照先に file 構造体のポインタを入れる
@@ -40,6 +42,7 @@ pipealloc(struct file **f0, struct file **f1)
   pi->writeopen = 1;
   pi->nwrite = 0;
   pi->nread = 0;
+  pi->pq.head = 0;
   initlock(&pi->lock, "pipe");
   // ひとつめの引数には読み取り用のファイル構造体を返す
   (*f0)->type = FD_PIPE;
@@ -74,6 +77,7 @@ pipeclose(struct pipe *pi, int writable)
     pi->readopen = 0;
     wakeup(&pi->nwrite);
   }
+  pollwake(&pi->pq);
   if(pi->readopen == 0 && pi->writeopen == 0){
     release(&pi->lock);
     kfree((char*)pi);
@@ -81,8 +85,10 @@ pipeclose(struct pipe *pi, int writable)
     release(&pi->lock);
 }
 
+// if nonblock, write only what fits, and
+// return -1 if nothing does.
 int
-pipewrite(struct pipe *pi, uint64 addr, int n)
+pipewrite(struct pipe *pi, uint64 addr, int n, int nonblock)
 {
   int i = 0;
   struct proc *pr = myproc();
@@ -94,8 +100,14 @@ pipewrite(struct pipe *pi, uint64 addr, int n)
       return -1;
     }
     if(pi->nwrite == pi->nread + PIPESIZE){ //DOC: pipewrite-full
+      if(nonblock){
+        if(i == 0)
+          i = -1;
+        break;
+      }
       // バッファがいっぱいになってしまったら、読み取り待ちのプロセスを起こして sleep する
       wakeup(&pi->nread);
+      pollwake(&pi->pq);
       sleep(&pi->nwrite, &pi->lock);
     } else {
       char ch;
@@ -108,13 +120,15 @@ pipewrite(struct pipe *pi, uint64 addr, int n)
   }
   // 書き終わったので、読み取り待ちのプロセスを起こす
   wakeup(&pi->nread);
+  pollwake(&pi->pq);
   release(&pi->lock);
 
   return i;
 }
 
+// if nonblock, return -1 rather than wait for data.
 int
-piperead(struct pipe *pi, uint64 addr, int n)
+piperead(struct pipe *pi, uint64 addr, int n, int nonblock)
 {
   int i;
   struct proc *pr = myproc();
@@ -125,7 +139,7 @@ piperead(struct pipe *pi, uint64 addr, int n)
   // 書いたバイト数と読んだバイト数が同じならからっぽなので、sleep して待つ
   while(pi->nread == pi->nwrite && pi->writeopen){  //DOC: pipe-empty
     // いつのまにかプロセスが kill されてしまっていたら抜ける
-    if(killed(pr)){
+    if(killed(pr) || nonblock){
       release(&pi->lock);
       return -1;
     }
@@ -146,6 +160,32 @@ piperead(struct pipe *pi, uint64 addr, int n)
   // 読み終わったのでパイプがあいた状態
   // よって write 側でバッファがあくのを待っているプロセスを起こす
   wakeup(&pi->nwrite);  //DOC: piperead-wakeup
+  pollwake(&pi->pq);
   release(&pi->lock);
   return i;
 }
+
+// Which of POLLIN, POLLOUT and POLLHUP hold for the read end
+// (or, if writable, the write end); see filepoll().
+int
+pipepoll(struct pipe *pi, int writable, struct pollent *e)
+{
+  int r = 0;
+
+  acquire(&pi->lock);
+  if(writable){
+    if(pi->readopen == 0)
+      r = POLLOUT | POLLHUP;  // write fails without waiting
+    else if(pi->nwrite != pi->nread + PIPESIZE)
+      r = POLLOUT;
+  } else {
+    if(pi->writeopen == 0)
+      r = POLLIN | POLLHUP;   // read returns 0 without waiting
+    else if(pi->nread != pi->nwrite)
+      r = POLLIN;
+  }
+  if(e)
+    pollqadd(&pi->pq, &pi->lock, e);
+  release(&pi->lock);
+  return r;
+}
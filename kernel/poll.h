@@ -0,0 +1,27 @@
+// for poll()
+struct pollfd {
+  int fd;
+  short events;   // what to wait for
+  short revents;  // what happened
+};
+
+#define POLLIN   0x001  // read won't block
+#define POLLOUT  0x004  // write won't block
+#define POLLHUP  0x010  // other end closed; always reported
+#define POLLNVAL 0x020  // fd not open; always reported
+
+#define MAXPOLL  64     // max fds per poll()
+
+// Wait queue of processes polling an object, such as a pipe.
+// Protected by the object's own lock.
+struct pollq {
+  struct pollent *head;
+};
+
+// One poll() call's place on one object's pollq.
+struct pollent {
+  struct pollent *next;
+  struct pollq *q;        // queue this entry is on, or 0
+  struct spinlock *lk;    // lock protecting q
+  int *woken;             // set by pollwake(), and poll() sleeps on it
+};
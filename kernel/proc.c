@@ -4,16 +4,45 @@
 #include "riscv.h"
 #include "spinlock.h"
 #include "proc.h"
+#include "procinfo.h"
+#include "trace.h"
 #include "defs.h"
+#include "poll.h"
+#include "slab.h"
 
 struct cpu cpus[NCPU];
 
-struct proc proc[NPROC];
+// Process structures come from a slab cache, but are never
+// given back to it: once allocated, a struct proc stays on the
+// procs list for good, and goes on the free list when it is
+// UNUSED. So the scheduler can walk procs without a lock, and
+// a struct proc found by pid stays a struct proc even if the
+// process exits, though its pid must be checked again under
+// p->lock. There are never more than NPROC of them.
+//
+// Each struct proc has a place for its kernel stack at
+// KSTACK(n), where n is the number of procs made before it.
+// A process's stack is mapped there while it exists. Up to
+// NKSTACKFREE UNUSED procs keep theirs, so that fork() seldom
+// has to map one; the rest give the page back.
+struct {
+  struct spinlock lock;       // protects the free lists, adding to procs, and kernel stacks
+  struct slabcache cache;
+  struct proc *procs;         // every struct proc, linked by next
+  struct proc *free;          // UNUSED ones with a kernel stack, linked by nextfree
+  int nfree;                  // how many on free
+  struct proc *bare;          // UNUSED ones without, linked by nextfree
+  int nproc;
+} ptable;
 
 struct proc *initproc;
 
+// pids are never reused. pid_lock protects nextpid and the
+// pid hash table, which holds every process that has a pid.
+#define NPIDHASH 256
 int nextpid = 1;
 struct spinlock pid_lock;
+static struct proc *pidhash[NPIDHASH];
 
 extern void forkret(void);
 static void freeproc(struct proc *p);
@@ -26,48 +55,15 @@ extern char trampoline[]; // trampoline.S
 // must be acquired before any p->lock.
 struct spinlock wait_lock;
 
-// Allocate a page for each process's kernel stack.
-// Map it high in memory, followed by an invalid
-// guard page.
-void
-proc_mapstacks(pagetable_t kpgtbl)
-{
-  struct proc *p;
-  
-  // xv6 ではプロセス数は NPROC で固定されており、管理領域も最初に準備される
-  // すべてのプロセス用管理領域に対してループで初期化していく
-  for(p = proc; p < &proc[NPROC]; p++) {
-    // まずページテーブルを用意
-    char *pa = kalloc();
-    if(pa == 0)
-      panic("kalloc");
-    // 仮想アドレスの後ろのほうに各プロセスのページテーブル用ページをマップする
-    // それぞれのページの間に使っていないページが入っている
-    // (KSTACK で 2*PGSIZE となっているので1ページずつ分ずつあいている)
-    uint64 va = KSTACK((int) (p - proc));
-
-    // カーネルのページテーブルにはすべてのプロセスのページテーブルが含まれているので
-    // プロセス切り替え時の操作などが行える
-    kvmmap(kpgtbl, va, (uint64)pa, PGSIZE, PTE_R | PTE_W);
-  }
-}
-
 // initialize the proc table.
 void
 procinit(void)
 {
-  struct proc *p;
-  
+  initlock(&ptable.lock, "ptable");
+  slabinit(&ptable.cache, "proc", sizeof(struct proc));
   initlock(&pid_lock, "nextpid");
   initlock(&wait_lock, "wait_lock");
-  // すべてのプロセスに対してループ
-  for(p = proc; p < &proc[NPROC]; p++) {
-      initlock(&p->lock, "proc");
-      // プロセス構造体を初期化するだけ
-      // 特にスタック用のページの確保などはしない
-      p->state = UNUSED;
-      p->kstack = KSTACK((int) (p - proc));
-  }
+  initlock(&polllock, "poll");
 }
 
 // ここで得た cpuid は、タイマ割込みによるコンテキストスイッチがあって
@@ -107,21 +103,98 @@ myproc(void)
   return p;
 }
 
-// pid を1ずつインクリメントして返すだけ
-int
-allocpid()
+// pid を1ずつインクリメントして返し、p をハッシュ表に登録する
+// Give p a new pid, and enter it in the pid hash table.
+static void
+allocpid(struct proc *p)
 {
-  int pid;
-  
   acquire(&pid_lock);
-  pid = nextpid;
+  p->pid = nextpid;
   nextpid = nextpid + 1;
+  p->pidnext = pidhash[p->pid % NPIDHASH];
+  pidhash[p->pid % NPIDHASH] = p;
   release(&pid_lock);
+}
 
-  return pid;
+// Take p out of the pid hash table.
+static void
+freepid(struct proc *p)
+{
+  struct proc **pp;
+
+  acquire(&pid_lock);
+  for(pp = &pidhash[p->pid % NPIDHASH]; *pp; pp = &(*pp)->pidnext){
+    if(*pp == p){
+      *pp = p->pidnext;
+      break;
+    }
+  }
+  release(&pid_lock);
+  p->pidnext = 0;
 }
 
-// Look in the process table for an UNUSED proc.
+// The process with the given pid, or 0. The caller must
+// acquire p->lock and check p->pid, since the process may
+// exit and its struct proc be reused at any time.
+static struct proc*
+findproc(int pid)
+{
+  struct proc *p;
+
+  acquire(&pid_lock);
+  for(p = pidhash[pid % NPIDHASH]; p; p = p->pidnext)
+    if(p->pid == pid)
+      break;
+  release(&pid_lock);
+  return p;
+}
+
+// Take an UNUSED proc off a free list, or make a new one if
+// there is none and there are fewer than NPROC. Returns it
+// with its kernel stack mapped, or 0.
+static struct proc*
+getproc(void)
+{
+  struct proc *p;
+
+  acquire(&ptable.lock);
+  if((p = ptable.free) != 0){
+    ptable.free = p->nextfree;
+    ptable.nfree--;
+    release(&ptable.lock);
+    return p;
+  }
+  if((p = ptable.bare) != 0){
+    ptable.bare = p->nextfree;
+  } else {
+    if(ptable.nproc >= NPROC || (p = slaballoc(&ptable.cache)) == 0){
+      release(&ptable.lock);
+      return 0;
+    }
+    memset(p, 0, sizeof(*p));
+    p->kstack = KSTACK(ptable.nproc);
+    initlock(&p->lock, "proc");
+    p->state = UNUSED;
+    p->ofile = p->ofile0;
+    p->nofile = NOFILE;
+    // finish p before the scheduler can find it.
+    __sync_synchronize();
+    p->next = ptable.procs;
+    ptable.procs = p;
+    ptable.nproc++;
+  }
+  // a hart that runs p flushes its TLB first, to see the stack.
+  if(kvmstack(p->kstack) < 0){
+    p->nextfree = ptable.bare;
+    ptable.bare = p;
+    release(&ptable.lock);
+    return 0;
+  }
+  release(&ptable.lock);
+  return p;
+}
+
+// Find an UNUSED proc.
 // If found, initialize state required to run in the kernel,
 // and return with p->lock held.
 // If there are no free procs, or a memory allocation fails, return 0.
@@ -130,20 +203,13 @@ allocproc(void)
 {
   struct proc *p;
 
-  for(p = proc; p < &proc[NPROC]; p++) {
-    acquire(&p->lock);
-    if(p->state == UNUSED) {
-      goto found;
-    } else {
-      release(&p->lock);
-    }
-  }
-  // xv6 では最大プロセス数は固定、空きがなければ失敗する
-  return 0;
+  // xv6 では最大プロセス数は NPROC、空きがなければ失敗する
+  if((p = getproc()) == 0)
+    return 0;
+  acquire(&p->lock);
 
-found:
   // 空いていたプロセス構造体に pid を入れ、ステータスを更新
-  p->pid = allocpid();
+  allocpid(p);
   p->state = USED;
 
   // trapframe は、トラップが発生した場合にレジスタを退避する領域
@@ -155,6 +221,16 @@ found:
     return 0;
   }
 
+  // Allocate a page for user code to read p's details from.
+  if((p->usyscall = (struct usyscall *)kalloc_zeroed()) == 0){
+    freeproc(p);
+    release(&p->lock);
+    return 0;
+  }
+  p->usyscall->pid = p->pid;
+  memset(p->sysacct, 0, sizeof(p->sysacct));
+  memset(&p->acct, 0, sizeof(p->acct));
+
   // ユーザ用に空のページテーブルを作り、trampoline と trapframe をマップ
   // An empty user page table.
   p->pagetable = proc_pagetable(p);
@@ -182,21 +258,57 @@ freeproc(struct proc *p)
   if(p->trapframe)
     kfree((void*)p->trapframe);
   p->trapframe = 0;
+  if(p->usyscall)
+    kfree((void*)p->usyscall);
+  p->usyscall = 0;
   if(p->pagetable)
     proc_freepagetable(p->pagetable, p->sz);
   p->pagetable = 0;
+  if(p->ring)
+    kfree((void*)p->ring);
+  p->ring = 0;
+  if(p->ofile != p->ofile0)
+    kmfree(p->ofile);
+  p->ofile = p->ofile0;
+  p->nofile = NOFILE;
+  if(p->perf)
+    kmfree(p->perf);
+  p->perf = 0;
   p->sz = 0;
+  p->ustack = 0;
+  p->pinva = p->pinend = 0;
+  p->asid = 0;
+  p->tlbstale = 0;
+  if(p->pid)
+    freepid(p);
   p->pid = 0;
   p->parent = 0;
+  p->sibling = 0;
   p->name[0] = 0;
   p->chan = 0;
   p->killed = 0;
   p->xstate = 0;
   p->state = UNUSED;
+
+  // nothing runs on p's kernel stack: p never ran, or it
+  // exited and switched away, which wait() holding p->lock
+  // guarantees. keep the stack for the next fork(), unless
+  // enough UNUSED procs have one.
+  acquire(&ptable.lock);
+  if(ptable.nfree < NKSTACKFREE){
+    p->nextfree = ptable.free;
+    ptable.free = p;
+    ptable.nfree++;
+  } else {
+    kvmunstack(p->kstack);
+    p->nextfree = ptable.bare;
+    ptable.bare = p;
+  }
+  release(&ptable.lock);
 }
 
 // Create a user page table for a given process, with no user memory,
-// but with trampoline and trapframe pages.
+// but with trampoline, trapframe, usyscall and vdso pages.
 pagetable_t
 proc_pagetable(struct proc *p)
 {
@@ -226,6 +338,31 @@ proc_pagetable(struct proc *p)
     return 0;
   }
 
+  // map the usyscall and vdso pages below the trapframe,
+  // readable by user code.
+  if(mappages(pagetable, USYSCALL, PGSIZE,
+              (uint64)(p->usyscall), PTE_R | PTE_U) < 0){
+    uvmunmap(pagetable, TRAMPOLINE, 1, 0);
+    uvmunmap(pagetable, TRAPFRAME, 1, 0);
+    uvmfree(pagetable, 0);
+    return 0;
+  }
+  if(mappages(pagetable, VDSO, PGSIZE, (uint64)vdso, PTE_R | PTE_U) < 0){
+    uvmunmap(pagetable, TRAMPOLINE, 1, 0);
+    uvmunmap(pagetable, TRAPFRAME, 1, 0);
+    uvmunmap(pagetable, USYSCALL, 1, 0);
+    uvmfree(pagetable, 0);
+    return 0;
+  }
+
+#ifdef SHAREDPT
+  // map the kernel.
+  if(kvmshare(pagetable) < 0){
+    proc_freepagetable(pagetable, 0);
+    return 0;
+  }
+#endif
+
   return pagetable;
 }
 
@@ -234,8 +371,15 @@ proc_pagetable(struct proc *p)
 void
 proc_freepagetable(pagetable_t pagetable, uint64 sz)
 {
+#ifdef SHAREDPT
+  kvmunshare(pagetable);
+#endif
   uvmunmap(pagetable, TRAMPOLINE, 1, 0);
   uvmunmap(pagetable, TRAPFRAME, 1, 0);
+  uvmunmap(pagetable, USYSCALL, 1, 0);
+  uvmunmap(pagetable, VDSO, 1, 0);
+  if(walkaddr(pagetable, URING))
+    uvmunmap(pagetable, URING, 1, 0);
   uvmfree(pagetable, sz);
 }
 
@@ -284,7 +428,7 @@ userinit(void)
 int
 growproc(int n)
 {
-  uint64 sz;
+  uint64 sz, oldsz, end;
   // growproc を呼んだプロセスの proc 構造体を取得
   // ページを取得・開放し、proc 構造体に含まれるページテーブルを更新する
   struct proc *p = myproc();
@@ -292,8 +436,19 @@ growproc(int n)
   sz = p->sz;
   if(n > 0){
     // サイズを増やす
-    if((sz = uvmalloc(p->pagetable, sz, sz + n, PTE_W)) == 0) {
-      return -1;
+    // a megabyte at a time, raising p->sz as we go: swapout()
+    // only takes pages below p->sz, so growing by more than
+    // fits in memory needs the pages already added to count.
+    oldsz = sz;
+    while(sz < oldsz + n){
+      end = PGROUNDDOWN(sz) + GROWSTEP;
+      if(end > oldsz + n)
+        end = oldsz + n;
+      if((sz = uvmalloc(p->pagetable, sz, end, PTE_W)) == 0) {
+        p->sz = uvmdealloc(p->pagetable, p->sz, oldsz);
+        return -1;
+      }
+      p->sz = sz;
     }
   } else if(n < 0){
     // サイズを減らす
@@ -308,7 +463,7 @@ growproc(int n)
 int
 fork(void)
 {
-  int i, pid;
+  int pid;
   struct proc *np;
   struct proc *p = myproc();
 
@@ -317,13 +472,18 @@ fork(void)
     return -1;
   }
 
-  // Copy user memory from parent to child.
+  // Copy user memory from parent to child, without np->lock:
+  // kalloc() may have to wait for pages to be swapped out.
+  release(&np->lock);
   if(uvmcopy(p->pagetable, np->pagetable, p->sz) < 0){
+    acquire(&np->lock);
     freeproc(np);
     release(&np->lock);
     return -1;
   }
+  acquire(&np->lock);
   np->sz = p->sz;
+  np->ustack = p->ustack;
 
   // copy saved user registers.
   *(np->trapframe) = *(p->trapframe);
@@ -332,9 +492,11 @@ fork(void)
   np->trapframe->a0 = 0;
 
   // increment reference counts on open file descriptors.
-  for(i = 0; i < NOFILE; i++)
-    if(p->ofile[i])
-      np->ofile[i] = filedup(p->ofile[i]);
+  if(fdcopy(np, p) < 0){
+    freeproc(np);
+    release(&np->lock);
+    return -1;
+  }
   np->cwd = idup(p->cwd);
 
   safestrcpy(np->name, p->name, sizeof(p->name));
@@ -343,15 +505,67 @@ fork(void)
 
   release(&np->lock);
 
+  procstart(np);
+
+  return pid;
+}
+
+// Make np a child of the current process, and let it run.
+void
+procstart(struct proc *np)
+{
+  struct proc *p = myproc();
+
   acquire(&wait_lock);
   np->parent = p;
+  np->sibling = p->children;
+  p->children = np;
   release(&wait_lock);
 
   acquire(&np->lock);
   np->state = RUNNABLE;
   release(&np->lock);
+}
 
-  return pid;
+// Create a process for spawn(), with the current process's
+// open files and current directory but no user memory. The
+// caller gives it a program with execproc() and starts it
+// with procstart(), or gives up with spawnfree().
+struct proc*
+spawnalloc(void)
+{
+  struct proc *np;
+  struct proc *p = myproc();
+
+  if((np = allocproc()) == 0)
+    return 0;
+  if(fdcopy(np, p) < 0){
+    freeproc(np);
+    release(&np->lock);
+    return 0;
+  }
+  np->cwd = idup(p->cwd);
+  memset(np->trapframe, 0, sizeof(*np->trapframe));
+
+  // np isn't runnable and has no parent, so nothing else
+  // looks at it, and execproc() may sleep.
+  release(&np->lock);
+  return np;
+}
+
+// Free a process from spawnalloc() that never ran.
+void
+spawnfree(struct proc *np)
+{
+  fdcloseall(np);
+  begin_op();
+  iput(np->cwd);
+  end_op();
+  np->cwd = 0;
+
+  acquire(&np->lock);
+  freeproc(np);
+  release(&np->lock);
 }
 
 // Pass p's abandoned children to init.
@@ -361,12 +575,18 @@ reparent(struct proc *p)
 {
   struct proc *pp;
 
-  for(pp = proc; pp < &proc[NPROC]; pp++){
-    if(pp->parent == p){
-      pp->parent = initproc;
-      wakeup(initproc);
-    }
+  if((pp = p->children) == 0)
+    return;
+  for(;;){
+    pp->parent = initproc;
+    if(pp->sibling == 0)
+      break;
+    pp = pp->sibling;
   }
+  pp->sibling = initproc->children;
+  initproc->children = p->children;
+  p->children = 0;
+  wakeup(initproc);
 }
 
 // Exit the current process.  Does not return.
@@ -381,13 +601,7 @@ exit(int status)
     panic("init exiting");
 
   // Close all open files.
-  for(int fd = 0; fd < NOFILE; fd++){
-    if(p->ofile[fd]){
-      struct file *f = p->ofile[fd];
-      fileclose(f);
-      p->ofile[fd] = 0;
-    }
-  }
+  fdcloseall(p);
 
   begin_op();
   iput(p->cwd);
@@ -427,49 +641,45 @@ exit(int status)
 int
 wait(uint64 addr)
 {
-  struct proc *pp;
-  int havekids, pid;
+  struct proc *pp, **ppp;
+  int pid;
   struct proc *p = myproc();
 
   acquire(&wait_lock);
 
   for(;;){
-    // Scan through table looking for exited children.
-    havekids = 0;
-    for(pp = proc; pp < &proc[NPROC]; pp++){
-      // 自分の子プロセスを探す
-      if(pp->parent == p){
-        // make sure the child isn't still in exit() or swtch().
-        acquire(&pp->lock);
-
-        havekids = 1;
-        // 子プロセスが先に終了していた場合は zombie 状態になっている
-        if(pp->state == ZOMBIE){
-          // Found one.
-          pid = pp->pid;
-          // 子プロセスの終了コードを、引数として受け取った(ユーザ空間の)アドレスにコピー
-          if(addr != 0 && copyout(p->pagetable, addr, (char *)&pp->xstate,
-                                  sizeof(pp->xstate)) < 0) {
-            release(&pp->lock);
-            release(&wait_lock);
-            return -1;
-          }
-          // trapframe の開放など、プロセス構造体の開放処理を行う
-          freeproc(pp);
+    // Scan through p's children looking for exited ones.
+    for(ppp = &p->children; (pp = *ppp) != 0; ppp = &pp->sibling){
+      // make sure the child isn't still in exit() or swtch().
+      acquire(&pp->lock);
+
+      // 子プロセスが先に終了していた場合は zombie 状態になっている
+      if(pp->state == ZOMBIE){
+        // Found one.
+        pid = pp->pid;
+        // 子プロセスの終了コードを、引数として受け取った(ユーザ空間の)アドレスにコピー
+        if(addr != 0 && copyout(p->pagetable, addr, (char *)&pp->xstate,
+                                sizeof(pp->xstate)) < 0) {
           release(&pp->lock);
           release(&wait_lock);
-          // 終了済みの子プロセスがいたら、いったん return してしまう
-          // そうしないと子プロセスの終了コードなどを返せなくなってしまうため
-          // wait を呼ぶアプリ側では何度も wait する必要がある
-          return pid;
+          return -1;
         }
+        // trapframe の開放など、プロセス構造体の開放処理を行う
+        *ppp = pp->sibling;
+        freeproc(pp);
         release(&pp->lock);
+        release(&wait_lock);
+        // 終了済みの子プロセスがいたら、いったん return してしまう
+        // そうしないと子プロセスの終了コードなどを返せなくなってしまうため
+        // wait を呼ぶアプリ側では何度も wait する必要がある
+        return pid;
       }
+      release(&pp->lock);
     }
 
     // 子プロセスが見つからずに上記ループを抜けていたら終わり
     // No point waiting if we don't have any children.
-    if(!havekids || killed(p)){
+    if(p->children == 0 || killed(p)){
       release(&wait_lock);
       return -1;
     }
@@ -494,23 +704,44 @@ scheduler(void)
 {
   struct proc *p;
   struct cpu *c = mycpu();
+  int found;
   
   c->proc = 0;
   for(;;){
     // Avoid deadlock by ensuring that devices can interrupt.
     intr_on();
 
+    found = 0;
     // 全プロセスのうち runnable なものを順番に実行していく
-    for(p = proc; p < &proc[NPROC]; p++) {
+    for(p = ptable.procs; p; p = p->next) {
       acquire(&p->lock);
       if(p->state == RUNNABLE) {
         // Switch to chosen process.  It is the process's job
         // to release its lock and then reacquire it
         // before jumping back to us.
+        TRACE(TR_SWITCH, p->pid, 0);
+        found = 1;
         p->state = RUNNING;
         c->proc = p;
+        p->acct.stamp = r_time();
+        if(p->perf)
+          perfin(p);
+#ifdef SHAREDPT
+        // p's kernel thread runs on p's page table.
+        uvmswitch(p);
+#endif
+        // p's kernel stack may be newly mapped.
+        kvmstacksync();
         // swtch を呼んでユーザプロセスに切り替え(しばらく戻ってこない)
         swtch(&c->context, &p->context);
+#ifdef SHAREDPT
+        // leave p's page table before releasing p->lock,
+        // after which wait() may free it.
+        kvmswitch();
+#endif
+        if(p->perf)
+          perfout(p);
+        p->acct.stime += r_time() - p->acct.stamp;
 
         // Process is done running for now.
         // It should have changed its p->state before coming back.
@@ -518,6 +749,9 @@ scheduler(void)
       }
       release(&p->lock);
     }
+    // nothing to run: zero a page for kalloc_zeroed().
+    if(!found)
+      kzerofill();
   }
 }
 
@@ -566,6 +800,7 @@ yield(void)
   acquire(&p->lock);
   // 今まで実行中だったプロセスステータスを実行可能にして、sched で切り替え
   p->state = RUNNABLE;
+  p->acct.nivcsw++;
   sched();
   // この release は、別プロセスで acquire したロックを手放すもの
   // このプロセス自身が切り替え前に取ったロックを開放するわけではない
@@ -628,6 +863,8 @@ sleep(void *chan, struct spinlock *lk)
   // Go to sleep.
   p->chan = chan;
   p->state = SLEEPING;
+  p->acct.nvcsw++;
+  TRACE(TR_SLEEP, (uint64)chan, 0);
 
   sched();
 
@@ -646,7 +883,7 @@ wakeup(void *chan)
 {
   struct proc *p;
 
-  for(p = proc; p < &proc[NPROC]; p++) {
+  for(p = ptable.procs; p; p = p->next) {
     // すべてのプロセスを見て、wakeup を呼んだプロセス以外のものに対して処理する
     if(p != myproc()){
       acquire(&p->lock);
@@ -654,12 +891,65 @@ wakeup(void *chan)
       // runnable にするだけで、切り替えはしない(sched は呼ばない)
       if(p->state == SLEEPING && p->chan == chan) {
         p->state = RUNNABLE;
+        TRACE(TR_WAKEUP, (uint64)chan, p->pid);
       }
       release(&p->lock);
     }
   }
 }
 
+// Wait queues for poll(). A pollable object keeps a pollq
+// under its own lock, and calls pollwake() whenever it may
+// have become ready. polllock protects every pollent's *woken,
+// which sys_poll() sleeps on.
+struct spinlock polllock;
+
+// Add e to q. Caller must hold lk, the lock that protects q.
+void
+pollqadd(struct pollq *q, struct spinlock *lk, struct pollent *e)
+{
+  e->q = q;
+  e->lk = lk;
+  e->next = q->head;
+  q->head = e;
+}
+
+// Take e off the queue it is on, if any.
+void
+pollqdel(struct pollent *e)
+{
+  struct pollent **pp;
+
+  if(e->q == 0)
+    return;
+  acquire(e->lk);
+  for(pp = &e->q->head; *pp; pp = &(*pp)->next){
+    if(*pp == e){
+      *pp = e->next;
+      break;
+    }
+  }
+  release(e->lk);
+  e->q = 0;
+}
+
+// Wake up every process polling q.
+// Caller must hold the lock that protects q.
+void
+pollwake(struct pollq *q)
+{
+  struct pollent *e;
+
+  if(q->head == 0)
+    return;
+  acquire(&polllock);
+  for(e = q->head; e; e = e->next){
+    *e->woken = 1;
+    wakeup(e->woken);
+  }
+  release(&polllock);
+}
+
 // Kill the process with the given pid.
 // The victim won't exit until it tries to return
 // to user space (see usertrap() in trap.c).
@@ -668,9 +958,9 @@ kill(int pid)
 {
   struct proc *p;
 
-  for(p = proc; p < &proc[NPROC]; p++){
+  // kill の対象となるプロセスを探す
+  if(pid > 0 && (p = findproc(pid)) != 0){
     acquire(&p->lock);
-    // kill の対象となるプロセスを探す
     if(p->pid == pid){
       // 具体的な終了処理をするわけではなく、プロセス構造体にフラグを立てるだけ
       // このプロセスは他の CPU でなにか重要な処理をしている可能性もあるので
@@ -701,6 +991,78 @@ setkilled(struct proc *p)
   release(&p->lock);
 }
 
+// Copy the accounting for system call num of the process
+// with the given pid into *a. Returns -1 if there is no such
+// process.
+int
+procsysacct(int pid, int num, struct sysacct *a)
+{
+  struct proc *p;
+
+  if(pid > 0 && (p = findproc(pid)) != 0){
+    acquire(&p->lock);
+    if(p->pid == pid){
+      *a = p->sysacct[num];
+      release(&p->lock);
+      return 0;
+    }
+    release(&p->lock);
+  }
+  return -1;
+}
+
+// The process after p in ptable.procs, or the first if p is 0.
+// For swapout(), which keeps its place between calls.
+struct proc*
+procnext(struct proc *p)
+{
+  return p ? p->next : ptable.procs;
+}
+
+// Copy a struct procinfo for each process that exists, up to
+// n of them, to user address addr. Returns how many.
+int
+procinfo(uint64 addr, int n)
+{
+  struct proc *p;
+  struct procinfo pi;
+  int i = 0;
+
+  for(p = ptable.procs; p && i < n; p = p->next){
+    acquire(&wait_lock);
+    acquire(&p->lock);
+    if(p->state == UNUSED){
+      release(&p->lock);
+      release(&wait_lock);
+      continue;
+    }
+    memset(&pi, 0, sizeof(pi));
+    pi.pid = p->pid;
+    pi.ppid = p->parent ? p->parent->pid : 0;
+    pi.state = p->state;
+    safestrcpy(pi.name, p->name, sizeof(pi.name));
+    pi.utime = p->acct.utime;
+    pi.stime = p->acct.stime;
+    pi.nvcsw = p->acct.nvcsw;
+    pi.nivcsw = p->acct.nivcsw;
+    pi.faults = p->acct.faults;
+    pi.rbytes = p->acct.rbytes;
+    pi.wbytes = p->acct.wbytes;
+    pi.sz = p->sz;
+    // holding p->lock keeps exec() and wait() from freeing
+    // the page table.
+    if(p->pagetable)
+      pi.rss = uvmresident(p->pagetable, p->sz, &pi.shared);
+    release(&p->lock);
+    release(&wait_lock);
+
+    if(copyout(myproc()->pagetable, addr + i*sizeof(pi), (char*)&pi, sizeof(pi)) < 0)
+      return -1;
+    i++;
+  }
+  return i;
+}
+
 int
 killed(struct proc *p)
 {
@@ -762,7 +1124,7 @@ procdump(void)
   char *state;
 
   printf("\n");
-  for(p = proc; p < &proc[NPROC]; p++){
+  for(p = ptable.procs; p; p = p->next){
     if(p->state == UNUSED)
       continue;
     if(p->state >= 0 && p->state < NELEM(states) && states[p->state])
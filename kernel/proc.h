@@ -24,6 +24,8 @@ struct cpu {
   struct context context;     // swtch() here to enter scheduler().
   int noff;                   // Depth of push_off() nesting.
   int intena;                 // Were interrupts enabled before push_off()?
+  int tlbflush;               // Flush whole TLB before next user entry (ASID rollover).
+  uint64 kstackgen;           // kernel stacks mapped as of the last flush, see kvmstacksync().
 };
 
 extern struct cpu cpus[NCPU];
@@ -79,6 +81,27 @@ struct trapframe {
   /* 280 */ uint64 t6;
 };
 
+// Time a process has spent in one system call; see sysaccount().
+struct sysacct {
+  uint64 count;
+  uint64 time;
+  uint64 max;
+};
+
+// What a process has used; see struct procinfo. Only the
+// process itself, and the scheduler while running it, update
+// these.
+struct procacct {
+  uint64 stamp;   // time of the last switch or user/kernel crossing
+  uint64 utime;
+  uint64 stime;
+  uint64 nvcsw;
+  uint64 nivcsw;
+  uint64 faults;
+  uint64 rbytes;
+  uint64 wbytes;
+};
+
 enum procstate { UNUSED, USED, SLEEPING, RUNNABLE, RUNNING, ZOMBIE };
 
 // Per-process state
@@ -92,16 +115,37 @@ struct proc {
   int xstate;                  // Exit status to be returned to parent's wait
   int pid;                     // Process ID
 
-  // wait_lock must be held when using this:
+  // wait_lock must be held when using these:
   struct proc *parent;         // Parent process
+  struct proc *children;       // First child
+  struct proc *sibling;        // Next child of parent
+
+  // see ptable and pid_lock in proc.c.
+  struct proc *next;           // Next in ptable.procs
+  struct proc *nextfree;       // Next in ptable.free
+  struct proc *pidnext;        // Next in pid hash chain
 
   // these are private to the process, so p->lock need not be held.
   uint64 kstack;               // Virtual address of kernel stack
   uint64 sz;                   // Size of process memory (bytes)
+  uint64 ustack;               // Lowest address the user stack may grow to, or 0
+  int vmpin;                   // If non-zero, swapout() leaves all of p's pages alone
+  uint64 pinva, pinend;        // User range swapout() leaves alone; see uvmpin()
   pagetable_t pagetable;       // User page table
+  uint64 asid;                 // ASID and its generation, see uvmsatp()
+  uint64 tlbstale;             // Harts that may hold stale TLB entries for asid
   struct trapframe *trapframe; // data page for trampoline.S
+  struct usyscall *usyscall;   // page mapped read-only at USYSCALL
+  struct ring *ring;           // page mapped at URING, or 0
   struct context context;      // swtch() here to run process
-  struct file *ofile[NOFILE];  // Open files
+  struct file **ofile;         // Open files, indexed by fd (see file.c)
+  int nofile;                  // Size of ofile
+  uint64 fdused[MAXFD/64];     // Bitmap of fds in use
+  struct file *ofile0[NOFILE]; // ofile, until it grows
   struct inode *cwd;           // Current directory
+  int logop;                   // Inside begin_op()/end_op()?
   char name[16];               // Process name (debugging)
+  struct sysacct sysacct[NSYSCALL]; // System calls made, by number
+  struct perf *perf;           // Counts of p's own execution, or 0 (see perf.c)
+  struct procacct acct;        // CPU time, switches, faults, I/O
 };
@@ -0,0 +1,26 @@
+// A process, as getprocinfo() describes it. Times are in
+// ticks of the time CSR (see vdso->timebase).
+struct procinfo {
+  int pid;
+  int ppid;           // parent's pid, or 0
+  int state;          // enum procstate in proc.h
+  char name[16];
+  uint64 utime;       // time in user space
+  uint64 stime;       // time in the kernel on the process's behalf
+  uint64 nvcsw;       // times it gave up the CPU to wait
+  uint64 nivcsw;      // times it was preempted
+  uint64 faults;      // page faults
+  uint64 rbytes;      // bytes read
+  uint64 wbytes;      // bytes written
+  uint64 sz;          // size of user memory, in bytes
+  uint64 rss;         // resident user pages
+  uint64 shared;      // ... of which shared with other processes
+};
+
+// states, for user programs.
+#define PI_UNUSED    0
+#define PI_USED      1
+#define PI_SLEEPING  2
+#define PI_RUNNABLE  3
+#define PI_RUNNING   4
+#define PI_ZOMBIE    5
@@ -0,0 +1,130 @@
+//
+// Sampling profiler.
+//
+// While the profiler is on, every timer interrupt on every
+// CPU records where the CPU was: the interrupted pc, whether
+// it was in user space, and which process was running. The
+// samples collect in a ring per CPU, so that CPUs don't
+// contend, until a reader takes them.
+//
+// The profiler is the PROF device. Writing "1" to it throws
+// away old samples and starts sampling; writing "0" stops.
+// Reading it returns whole struct profsamples and never
+// waits; a read that finds no samples returns 0. A ring
+// that fills up drops new samples until it is read.
+//
+
+#include "types.h"
+#include "param.h"
+#include "memlayout.h"
+#include "riscv.h"
+#include "spinlock.h"
+#include "sleeplock.h"
+#include "fs.h"
+#include "file.h"
+#include "proc.h"
+#include "prof.h"
+#include "defs.h"
+
+#define NPROFSAMPLE 512  // samples per CPU awaiting a reader
+
+struct profring {
+  struct spinlock lock;
+  uint r;  // read index
+  uint w;  // write index
+  struct profsample s[NPROFSAMPLE];
+};
+
+struct {
+  int on;
+  struct profring ring[NCPU];
+} prof;
+
+// Record where this CPU was when the timer interrupted it.
+// Called from devintr() on every CPU, with sepc and sstatus
+// still as the trap left them.
+void
+profintr(void)
+{
+  struct profring *r;
+  struct profsample *s;
+  struct proc *p;
+
+  if(!prof.on)
+    return;
+
+  r = &prof.ring[cpuid()];
+  acquire(&r->lock);
+  if(r->w - r->r < NPROFSAMPLE){
+    s = &r->s[r->w++ % NPROFSAMPLE];
+    s->pc = r_sepc();
+    s->user = (r_sstatus() & SSTATUS_SPP) == 0;
+    p = myproc();
+    if(p){
+      s->pid = p->pid;
+      safestrcpy(s->name, p->name, sizeof(s->name));
+    } else {
+      s->pid = 0;
+      safestrcpy(s->name, "-", sizeof(s->name));
+    }
+  }
+  release(&r->lock);
+}
+
+static int
+profread(int user_dst, uint64 dst, int n, int nonblock)
+{
+  struct profring *r;
+  int tot = 0;
+
+  for(r = prof.ring; r < prof.ring + NCPU; r++){
+    acquire(&r->lock);
+    while(r->r != r->w && n - tot >= sizeof(struct profsample)){
+      if(either_copyout(user_dst, dst + tot, &r->s[r->r % NPROFSAMPLE],
+                        sizeof(struct profsample)) < 0){
+        release(&r->lock);
+        return tot > 0 ? tot : -1;
+      }
+      r->r++;
+      tot += sizeof(struct profsample);
+    }
+    release(&r->lock);
+  }
+  return tot;
+}
+
+static int
+profwrite(int user_src, uint64 src, int n)
+{
+  struct profring *r;
+  char c;
+
+  if(n < 1 || either_copyin(&c, user_src, src, 1) < 0)
+    return -1;
+  if(c == '1'){
+    prof.on = 0;
+    for(r = prof.ring; r < prof.ring + NCPU; r++){
+      acquire(&r->lock);
+      r->r = r->w;
+      release(&r->lock);
+    }
+    __sync_synchronize();
+    prof.on = 1;
+  } else if(c == '0'){
+    prof.on = 0;
+  } else {
+    return -1;
+  }
+  return n;
+}
+
+void
+profinit(void)
+{
+  struct profring *r;
+
+  for(r = prof.ring; r < prof.ring + NCPU; r++)
+    initlock(&r->lock, "prof");
+  devsw[PROF].read = profread;
+  devsw[PROF].write = profwrite;
+}
@@ -0,0 +1,8 @@
+// A sample taken by the profiler in prof.c, as read from
+// the PROF device.
+struct profsample {
+  uint64 pc;      // interrupted program counter
+  int pid;        // interrupted process, or 0 if none
+  int user;       // pc is a user address in pid
+  char name[16];  // process name, for finding its symbols
+};
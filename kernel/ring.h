@@ -0,0 +1,43 @@
+// Submission and completion rings, shared between a process
+// and the kernel in the page that ringsetup() maps at URING.
+//
+// The process fills in sq[sqtail % RING_NENT] and advances
+// sqtail; ringenter() carries out every submitted entry in
+// order, posting one completion each at cq[cqtail % RING_NENT].
+// The process consumes completions by advancing cqhead.
+// Indices only ever increase; the kernel alone writes sqhead
+// and cqtail.
+
+#define RING_NENT 64   // entries in each ring
+
+// operations, with their arguments in struct ringsqe
+#define RING_READ   1  // read(fd, addr, n)
+#define RING_WRITE  2  // write(fd, addr, n)
+#define RING_OPEN   3  // open(addr, n)
+#define RING_CLOSE  4  // close(fd)
+#define RING_FSTAT  5  // fstat(fd, addr)
+#define RING_FSYNC  6  // fsync(fd)
+
+struct ringsqe {
+  int op;
+  int fd;
+  uint64 addr;   // user buffer, path, or struct stat
+  int n;         // byte count, or open mode
+  int pad;
+  uint64 data;   // passed through to the completion
+};
+
+struct ringcqe {
+  uint64 data;   // from the submission
+  int res;       // what the system call would have returned
+  int pad;
+};
+
+struct ring {
+  uint sqhead;
+  uint sqtail;
+  uint cqhead;
+  uint cqtail;
+  struct ringsqe sq[RING_NENT];
+  struct ringcqe cq[RING_NENT];
+};
@@ -42,6 +42,7 @@ w_mepc(uint64 x)
 
 // Supervisor Status Register, sstatus
 
+#define SSTATUS_SUM (1L << 18) // Supervisor may access User memory
 #define SSTATUS_SPP (1L << 8)  // Previous mode, 1=Supervisor, 0=User
 #define SSTATUS_SPIE (1L << 5) // Supervisor Previous Interrupt Enable
 #define SSTATUS_UPIE (1L << 4) // User Previous Interrupt Enable
@@ -199,7 +200,13 @@ w_pmpaddr0(uint64 x)
 // use riscv's sv39 page table scheme.
 #define SATP_SV39 (8L << 60)
 
-#define MAKE_SATP(pagetable) (SATP_SV39 | (((uint64)pagetable) >> 12))
+// satp's address-space identifier (ASID) field, which tags
+// TLB entries with the address space they belong to.
+#define SATP_ASID_SHIFT 44
+#define SATP_ASID_MASK 0xFFFFL
+#define SATP_ASID(satp) (((satp) >> SATP_ASID_SHIFT) & SATP_ASID_MASK)
+
+#define MAKE_SATP(pagetable, asid) (SATP_SV39 | (((uint64)(asid)) << SATP_ASID_SHIFT) | (((uint64)pagetable) >> 12))
 
 // supervisor address translation and protection;
 // holds the address of the page table.
@@ -256,6 +263,26 @@ r_mcounteren()
   return x;
 }
 
+// Supervisor Counter-Enable
+static inline void 
+w_scounteren(uint64 x)
+{
+  asm volatile("csrw scounteren, %0" : : "r" (x));
+}
+
+static inline uint64
+r_scounteren()
+{
+  uint64 x;
+  asm volatile("csrr %0, scounteren" : "=r" (x) );
+  return x;
+}
+
+#define COUNTEREN_CY (1L << 0) // cycle CSR readable one level down
+#define COUNTEREN_TM (1L << 1) // time CSR readable one level down
+#define COUNTEREN_IR (1L << 2) // instret CSR readable one level down
+#define COUNTEREN_HPM(n) (1L << (n)) // hpmcounter<n> readable one level down
+
 // machine-mode cycle counter
 static inline uint64
 r_time()
@@ -265,6 +292,52 @@ r_time()
   return x;
 }
 
+// cycles executed by this hart
+static inline uint64
+r_cycle()
+{
+  uint64 x;
+  asm volatile("csrr %0, cycle" : "=r" (x) );
+  return x;
+}
+
+// instructions retired by this hart
+static inline uint64
+r_instret()
+{
+  uint64 x;
+  asm volatile("csrr %0, instret" : "=r" (x) );
+  return x;
+}
+
+// hardware performance monitoring counters 3 through 6,
+// counting the events selected by mhpmevent3 through 6.
+static inline uint64
+r_hpmcounter(int n)
+{
+  uint64 x = 0;
+  switch(n){
+  case 3: asm volatile("csrr %0, hpmcounter3" : "=r" (x) ); break;
+  case 4: asm volatile("csrr %0, hpmcounter4" : "=r" (x) ); break;
+  case 5: asm volatile("csrr %0, hpmcounter5" : "=r" (x) ); break;
+  case 6: asm volatile("csrr %0, hpmcounter6" : "=r" (x) ); break;
+  }
+  return x;
+}
+
+// Machine-mode HPM event selectors. Only machine mode can
+// write them; see timervec in kernelvec.S.
+static inline void
+w_mhpmevent(int n, uint64 x)
+{
+  switch(n){
+  case 3: asm volatile("csrw mhpmevent3, %0" : : "r" (x)); break;
+  case 4: asm volatile("csrw mhpmevent4, %0" : : "r" (x)); break;
+  case 5: asm volatile("csrw mhpmevent5, %0" : : "r" (x)); break;
+  case 6: asm volatile("csrw mhpmevent6, %0" : : "r" (x)); break;
+  }
+}
+
 // enable device interrupts
 static inline void
 intr_on()
@@ -327,6 +400,14 @@ sfence_vma()
   asm volatile("sfence.vma zero, zero");
 }
 
+// flush the TLB entries of one address space.
+static inline void
+sfence_vma_asid(uint64 asid)
+{
+  // the zero means all addresses, but only those tagged with asid.
+  asm volatile("sfence.vma zero, %0" : : "r" (asid));
+}
+
 typedef uint64 pte_t;
 typedef uint64 *pagetable_t; // 512 PTEs
 
@@ -343,6 +424,10 @@ typedef uint64 *pagetable_t; // 512 PTEs
 #define PTE_W (1L << 2)
 #define PTE_X (1L << 3)
 #define PTE_U (1L << 4) // user can access
+#define PTE_A (1L << 6) // accessed since the bit was last cleared
+#define PTE_D (1L << 7) // dirty
+#define PTE_S (1L << 8) // (software) maps a page cache page
+#define PTE_SWAP (1L << 9) // (software) not valid: page is in swap slot PTE2SLOT
 
 // shift a physical address to the right place for a PTE.
 #define PA2PTE(pa) ((((uint64)pa) >> 12) << 10)
@@ -351,6 +436,11 @@ typedef uint64 *pagetable_t; // 512 PTEs
 
 #define PTE_FLAGS(pte) ((pte) & 0x3FF)
 
+// a swapped-out page's PTE keeps the swap slot where the
+// physical page number would be.
+#define SLOT2PTE(s) (((uint64)(s)) << 10)
+#define PTE2SLOT(pte) ((pte) >> 10)
+
 // extract the three 9-bit page table indices from a virtual address.
 #define PXMASK          0x1FF // 9 bits
 #define PXSHIFT(level)  (PGSHIFT+(9*(level)))
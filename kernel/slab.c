@@ -0,0 +1,166 @@
+//
+// Allocator for kernel objects smaller than a page.
+//
+// A slabcache hands out objects of one size, carved out of
+// pages (slabs) that it gets from kalloc(). Each slab begins
+// with a header that keeps a list of its free objects, so an
+// object's slab is found by rounding its address down to a
+// page boundary. kmalloc() picks among caches of power-of-two
+// sizes, and hands out whole pages for anything bigger.
+//
+
+#include "types.h"
+#include "param.h"
+#include "memlayout.h"
+#include "spinlock.h"
+#include "riscv.h"
+#include "slab.h"
+#include "defs.h"
+
+struct slabobj {
+  struct slabobj *next;
+};
+
+// at the start of each slab page.
+struct slab {
+  struct slab *next;        // cache's list of slabs with free objects
+  struct slab *prev;
+  struct slabcache *cache;
+  struct slabobj *free;     // free objects in this slab
+  int inuse;                // objects handed out
+};
+
+#define SLABHDR 64          // bytes reserved for struct slab
+
+// kmalloc()'s caches, for 32 bytes up to half a page.
+#define KMINSHIFT 5
+#define NKMCACHE 7
+static struct slabcache kmcache[NKMCACHE];
+
+void
+slabinit(struct slabcache *c, char *name, uint size)
+{
+  initlock(&c->lock, name);
+  c->name = name;
+  // keep objects 8-byte aligned.
+  c->size = (size + 7) & ~7;
+  if(c->size < sizeof(struct slabobj) || c->size > PGSIZE - SLABHDR)
+    panic("slabinit");
+  c->avail = 0;
+}
+
+void
+kmallocinit(void)
+{
+  static char *names[NKMCACHE] = {
+    "kmalloc32", "kmalloc64", "kmalloc128", "kmalloc256",
+    "kmalloc512", "kmalloc1024", "kmalloc2048",
+  };
+
+  if(sizeof(struct slab) > SLABHDR)
+    panic("kmallocinit");
+  for(int i = 0; i < NKMCACHE; i++)
+    slabinit(&kmcache[i], names[i], 1 << (i + KMINSHIFT));
+}
+
+// Put s at the head of its cache's list of slabs with free objects.
+static void
+slablink(struct slabcache *c, struct slab *s)
+{
+  s->prev = 0;
+  s->next = c->avail;
+  if(c->avail)
+    c->avail->prev = s;
+  c->avail = s;
+}
+
+static void
+slabunlink(struct slabcache *c, struct slab *s)
+{
+  if(s->prev)
+    s->prev->next = s->next;
+  else
+    c->avail = s->next;
+  if(s->next)
+    s->next->prev = s->prev;
+}
+
+// Allocate an object from cache c.
+// Returns 0 if the memory cannot be allocated.
+void*
+slaballoc(struct slabcache *c)
+{
+  struct slab *s;
+  struct slabobj *o;
+  char *p;
+
+  acquire(&c->lock);
+  if((s = c->avail) == 0){
+    if((s = (struct slab*)kalloc()) == 0){
+      release(&c->lock);
+      return 0;
+    }
+    s->cache = c;
+    s->free = 0;
+    s->inuse = 0;
+    for(p = (char*)s + PGSIZE - c->size; p >= (char*)s + SLABHDR; p -= c->size){
+      o = (struct slabobj*)p;
+      o->next = s->free;
+      s->free = o;
+    }
+    slablink(c, s);
+  }
+  o = s->free;
+  s->free = o->next;
+  s->inuse++;
+  if(s->free == 0)
+    slabunlink(c, s);
+  release(&c->lock);
+  return (void*)o;
+}
+
+// Free an object from slaballoc(). A slab whose objects are
+// all free goes back to kalloc(), unless it is the cache's
+// only slab with room.
+void
+slabfree(void *obj)
+{
+  struct slab *s = (struct slab*)PGROUNDDOWN((uint64)obj);
+  struct slabcache *c = s->cache;
+  struct slabobj *o = (struct slabobj*)obj;
+
+  acquire(&c->lock);
+  if(s->free == 0)
+    slablink(c, s);
+  o->next = s->free;
+  s->free = o;
+  if(--s->inuse == 0 && (c->avail != s || s->next != 0)){
+    slabunlink(c, s);
+    kfree((void*)s);
+  }
+  release(&c->lock);
+}
+
+// Allocate n bytes, 8-byte aligned.
+// Returns 0 if the memory cannot be allocated.
+void*
+kmalloc(uint n)
+{
+  for(int i = 0; i < NKMCACHE; i++)
+    if(n <= kmcache[i].size)
+      return slaballoc(&kmcache[i]);
+  if(n <= PGSIZE)
+    return kalloc();
+  return 0;
+}
+
+// Free memory from kmalloc(). Objects from a slab never start
+// on a page boundary, since the slab's header is there.
+void
+kmfree(void *p)
+{
+  if((uint64)p % PGSIZE == 0)
+    kfree(p);
+  else
+    slabfree(p);
+}
@@ -0,0 +1,7 @@
+// A cache of kernel objects of one size; see slab.c.
+struct slabcache {
+  struct spinlock lock;
+  char *name;           // for debugging
+  uint size;            // object size, in bytes
+  struct slab *avail;   // slabs with free objects
+};
@@ -16,17 +16,30 @@ initsleeplock(struct sleeplock *lk, char *name)
   lk->name = name;
   lk->locked = 0;
   lk->pid = 0;
+#ifdef LOCKSTAT
+  lk->class = lockclass(name, 1);
+#endif
 }
 
 void
 acquiresleep(struct sleeplock *lk)
 {
   acquire(&lk->lk);
+#ifdef LOCKSTAT
+  uint64 t0 = r_time();
+  int contended = lk->locked;
+#endif
   while (lk->locked) {
     sleep(lk, &lk->lk);
   }
   lk->locked = 1;
   lk->pid = myproc()->pid;
+#ifdef LOCKSTAT
+  lk->contended = contended;
+  lk->stamp = r_time();
+  lk->wait = lk->stamp - t0;
+  lk->pc = (uint64)__builtin_return_address(0);
+#endif
   release(&lk->lk);
 }
 
@@ -34,6 +47,10 @@ void
 releasesleep(struct sleeplock *lk)
 {
   acquire(&lk->lk);
+#ifdef LOCKSTAT
+  if(lk->class)
+    lockacct(lk->class, lk->contended, lk->wait, lk->pc, r_time() - lk->stamp);
+#endif
   lk->locked = 0;
   lk->pid = 0;
   wakeup(lk);
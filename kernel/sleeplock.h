@@ -6,5 +6,14 @@ struct sleeplock {
   // For debugging:
   char *name;        // Name of lock.
   int pid;           // Process holding lock
+
+#ifdef LOCKSTAT
+  // as in struct spinlock.
+  struct lockclass *class;
+  int contended;
+  uint64 wait;
+  uint64 stamp;
+  uint64 pc;
+#endif
 };
 
@@ -14,6 +14,9 @@ initlock(struct spinlock *lk, char *name)
   lk->name = name;
   lk->locked = 0;
   lk->cpu = 0;
+#ifdef LOCKSTAT
+  lk->class = lockclass(name, 0);
+#endif
 }
 
 // Acquire the lock.
@@ -32,8 +35,22 @@ acquire(struct spinlock *lk)
   //   a5 = 1
   //   s1 = &lk->locked
   //   amoswap.w.aq a5, a5, (s1)
+#ifdef LOCKSTAT
+  // the holder's statistics are in *lk, so keep ours aside
+  // until we hold it.
+  int contended = 0;
+  uint64 wait = 0;
+  if(__sync_lock_test_and_set(&lk->locked, 1) != 0){
+    uint64 t0 = r_time();
+    while(__sync_lock_test_and_set(&lk->locked, 1) != 0)
+      ;
+    contended = 1;
+    wait = r_time() - t0;
+  }
+#else
   while(__sync_lock_test_and_set(&lk->locked, 1) != 0)
     ;
+#endif
 
   // ロックへの読み書きと、ロックで守られたデータへの読み書きは、
   // コンパイラや CPU には依存がないように見えるので実行順が入れ替えられてしまう可能性がある
@@ -47,6 +64,12 @@ acquire(struct spinlock *lk)
 
   // Record info about lock acquisition for holding() and debugging.
   lk->cpu = mycpu();
+#ifdef LOCKSTAT
+  lk->contended = contended;
+  lk->wait = wait;
+  lk->pc = (uint64)__builtin_return_address(0);
+  lk->stamp = r_time();
+#endif
 }
 
 // Release the lock.
@@ -56,6 +79,11 @@ release(struct spinlock *lk)
   if(!holding(lk))
     panic("release");
 
+#ifdef LOCKSTAT
+  if(lk->class)
+    lockacct(lk->class, lk->contended, lk->wait, lk->pc, r_time() - lk->stamp);
+#endif
+
   lk->cpu = 0;
 
   // Tell the C compiler and the CPU to not move loads or stores
@@ -5,5 +5,14 @@ struct spinlock {
   // For debugging:
   char *name;        // Name of lock.
   struct cpu *cpu;   // The cpu holding the lock.
+
+#ifdef LOCKSTAT
+  // see lockstat.c.
+  struct lockclass *class; // statistics for locks of this name, or 0
+  int contended;     // did the holder have to wait?
+  uint64 wait;       // for how long
+  uint64 stamp;      // when the holder got the lock
+  uint64 pc;         // who called acquire()
+#endif
 };
 
@@ -10,8 +10,9 @@ void timerinit();
 // entry.S needs one stack per CPU.
 __attribute__ ((aligned (16))) char stack0[4096 * NCPU];
 
-// a scratch area per CPU for machine-mode timer interrupts.
-uint64 timer_scratch[NCPU][5];
+// a scratch area per CPU for machine-mode timer interrupts,
+// and for the HPM events that perf.c asks timervec to load.
+uint64 timer_scratch[NCPU][5+NHPM];
 
 // assembly code in kernelvec.S for machine-mode timer interrupt.
 extern void timervec();
@@ -37,8 +38,9 @@ start()
 
   // risc-v では、普通は割込みはマシンモードでしか処理できない
   // この委譲処理によりユーザモード時に発生した割込みを直接スーパーバイザモードで処理できる
-  // delegate all interrupts and exceptions to supervisor mode.
-  w_medeleg(0xffff);
+  // delegate all interrupts and exceptions to supervisor mode,
+  // except ecall from supervisor mode, which timervec handles.
+  w_medeleg(0xffff & ~(1 << 9));
   w_mideleg(0xffff);
   // csrw 命令で sie レジスタ(スーバーバイザモードの割り込み設定)を変更
   w_sie(r_sie() | SIE_SEIE | SIE_STIE | SIE_SSIE);
@@ -52,6 +54,17 @@ start()
   w_pmpaddr0(0x3fffffffffffffull);
   w_pmpcfg0(0xf);
 
+  // let supervisor and user mode read the time CSR, for the
+  // clock in the vdso page (see memlayout.h), and the cycle,
+  // instret and HPM counters, for perf.c and benchmarks.
+  uint64 ctrs = COUNTEREN_CY | COUNTEREN_TM | COUNTEREN_IR;
+  for(int i = 3; i < 3+NHPM; i++){
+    ctrs |= COUNTEREN_HPM(i);
+    w_mhpmevent(i, 0);
+  }
+  w_mcounteren(r_mcounteren() | ctrs);
+  w_scounteren(r_scounteren() | ctrs);
+
   // ask for clock interrupts.
   timerinit();
 
@@ -87,6 +100,7 @@ timerinit()
   // scratch[0..2] : space for timervec to save registers.
   // scratch[3] : address of CLINT MTIMECMP register.
   // scratch[4] : desired interval (in cycles) between timer interrupts.
+  // scratch[5..] : events for mhpmevent3.., see perf.c.
   uint64 *scratch = &timer_scratch[id][0];
   scratch[3] = CLINT_MTIMECMP(id);
   // タイマ割込みのハンドラで次のタイマのタイミングを計算するために、インターバルも控えておく
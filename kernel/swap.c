@@ -0,0 +1,264 @@
+//
+// Page reclaim and swap. When kalloc() runs out of pages, and
+// the page cache has none to give back, swapout() writes a
+// user page to the swap area that mkfs leaves after the file
+// system, and frees it. The page's PTE is left not valid, with
+// PTE_SWAP set and the swap slot in place of the physical page
+// number; the next touch of the page faults, and uvmfault()
+// calls swapin() to read it back.
+//
+// Victims are chosen by the CLOCK (second chance) algorithm:
+// a hand sweeps over every process's user memory, clearing the
+// accessed bit of each page it passes, and takes the first page
+// whose bit was already clear, i.e. that wasn't touched since
+// the hand last came by. Only ordinary user pages below p->sz
+// are candidates; page cache pages (PTE_S), the stack guard
+// page, and the pages the kernel keeps above p->sz (trapframe,
+// vdso, ring) never are.
+//
+// A process's page table is private to it, so swapout() only
+// takes pages from processes that are not running, holding
+// p->lock to keep them that way, or from the calling process
+// itself, from inside its own kalloc(). That means kernel code
+// must not hold the physical address of one of the process's
+// own pages across a kalloc(), nor across anything that may
+// let another process run: kerneltrap() sets p->vmpin while a
+// preempted process waits to run again, and uvmpin() keeps the
+// user buffers of copies made with spinlocks held in memory.
+//
+// Reading and writing swap sleeps, so kalloc() only reclaims,
+// and uvmfault() only swaps in, when the caller holds no
+// spinlocks and has interrupts on; otherwise they fail as if
+// out of memory.
+//
+
+#include "types.h"
+#include "param.h"
+#include "memlayout.h"
+#include "riscv.h"
+#include "spinlock.h"
+#include "sleeplock.h"
+#include "proc.h"
+#include "fs.h"
+#include "defs.h"
+
+struct {
+  struct spinlock lock;   // protects ref, busy and next
+  uint start;             // block number of slot 0
+  uint n;                 // number of slots
+  uint next;              // where to look for a free slot
+  ushort ref[SWAPSIZE];   // PTEs that refer to each slot
+  char busy[SWAPSIZE];    // being written by swapout()?
+
+  // the clock hand: the next page to look at is hand's va.
+  struct sleeplock clock;
+  struct proc *hand;
+  uint64 va;
+} swap;
+
+void
+swapinit(struct superblock *sb)
+{
+  initlock(&swap.lock, "swap");
+  initsleeplock(&swap.clock, "swapclock");
+  swap.start = sb->swapstart;
+  swap.n = sb->nswap;
+  if(swap.n > SWAPSIZE)
+    swap.n = SWAPSIZE;
+}
+
+// May the caller sleep? kalloc() is also called with spinlocks
+// held and with interrupts off.
+static int
+cansleep(void)
+{
+  struct cpu *c;
+  int ok;
+
+  push_off();
+  c = mycpu();
+  ok = c->proc != 0 && c->noff == 1 && c->intena;
+  pop_off();
+  return ok;
+}
+
+// Allocate a slot that swapout() is about to write.
+// Returns -1 if swap is full.
+static int
+slotalloc(void)
+{
+  uint i, s;
+
+  acquire(&swap.lock);
+  for(i = 0; i < swap.n; i++){
+    s = (swap.next + i) % swap.n;
+    if(swap.ref[s] == 0 && !swap.busy[s]){
+      swap.ref[s] = 1;
+      swap.busy[s] = 1;
+      swap.next = s + 1;
+      release(&swap.lock);
+      return s;
+    }
+  }
+  release(&swap.lock);
+  return -1;
+}
+
+// Another PTE, in a child made by fork(), refers to slot s.
+void
+swapdup(uint s)
+{
+  acquire(&swap.lock);
+  swap.ref[s]++;
+  release(&swap.lock);
+}
+
+// A PTE that referred to slot s is gone. Doesn't sleep, so
+// that page tables can be freed with p->lock held.
+void
+swapfree(uint s)
+{
+  acquire(&swap.lock);
+  if(swap.ref[s] == 0)
+    panic("swapfree");
+  swap.ref[s]--;
+  release(&swap.lock);
+}
+
+// May swapout() take p's pages? Caller holds p->lock.
+static int
+canswap(struct proc *p)
+{
+  if(p->pagetable == 0)
+    return 0;
+  if(p == myproc())
+    return 1;
+  return (p->state == SLEEPING || p->state == RUNNABLE) && p->vmpin == 0;
+}
+
+// Move the clock hand on to the next page that can be swapped
+// out, clearing accessed bits as it goes. Returns the page's
+// PTE with the process's lock held, or 0 if two trips around
+// all of memory found nothing.
+static pte_t*
+clocknext(struct proc **pp)
+{
+  struct proc *p;
+  pte_t *pte;
+  int laps = 0, cleared;
+
+  while(laps < 3){
+    if(swap.hand == 0){
+      swap.hand = procnext(0);
+      swap.va = 0;
+      laps++;
+    }
+    p = swap.hand;
+    acquire(&p->lock);
+    cleared = 0;
+    if(canswap(p)){
+      for(; swap.va < p->sz; swap.va += PGSIZE){
+        pte = walk(p->pagetable, swap.va, 0);
+        if(pte == 0 || (*pte & (PTE_V|PTE_U|PTE_S)) != (PTE_V|PTE_U))
+          continue;
+        if(swap.va >= p->pinva && swap.va < p->pinend)
+          continue;
+        if(*pte & PTE_A){
+          // second chance. harts that cached the PTE won't set
+          // PTE_A again until they drop it.
+          *pte &= ~PTE_A;
+          cleared = 1;
+          continue;
+        }
+        // swapout() drops p's TLB entries.
+        *pp = p;
+        return pte;
+      }
+    }
+    if(cleared && p == myproc())
+      uvmflush(p->pagetable);
+    else if(cleared)
+      p->tlbstale = ~0L;
+    release(&p->lock);
+    swap.hand = procnext(p);
+    swap.va = 0;
+  }
+  return 0;
+}
+
+// Write a user page out to swap and free it, for kalloc().
+// Returns 1 if it freed a page, 0 if not.
+int
+swapout(void)
+{
+  struct proc *p;
+  pte_t *pte;
+  uint64 pa;
+  int s;
+
+  if(swap.n == 0 || !cansleep())
+    return 0;
+
+  acquiresleep(&swap.clock);
+  if((pte = clocknext(&p)) == 0){
+    releasesleep(&swap.clock);
+    return 0;
+  }
+  if((s = slotalloc()) < 0){
+    release(&p->lock);
+    releasesleep(&swap.clock);
+    return 0;
+  }
+  pa = PTE2PA(*pte);
+  *pte = SLOT2PTE(s) | (PTE_FLAGS(*pte) & ~(PTE_V|PTE_A|PTE_D)) | PTE_SWAP;
+  // p isn't running, so its TLB entries need only be gone by
+  // the time it next runs; unless p is us.
+  if(p == myproc())
+    uvmflush(p->pagetable);
+  else
+    p->tlbstale = ~0L;
+  swap.va += PGSIZE;
+  release(&p->lock);
+  releasesleep(&swap.clock);
+
+  virtio_disk_page(swap.start + s*SWAPBPP, (void*)pa, 1);
+
+  acquire(&swap.lock);
+  swap.busy[s] = 0;
+  wakeup(&swap.busy[s]);
+  release(&swap.lock);
+  kfree((void*)pa);
+  return 1;
+}
+
+// Read the current process's page at va, whose PTE has
+// PTE_SWAP set, back in from swap. Returns 0, or -1 if out of
+// memory or the caller can't sleep.
+int
+swapin(pagetable_t pagetable, uint64 va)
+{
+  pte_t *pte;
+  char *mem;
+  uint s;
+
+  if(!cansleep())
+    return -1;
+  // allocate first: kalloc() may swap out other pages of ours,
+  // but not this one.
+  if((mem = kalloc()) == 0)
+    return -1;
+  if((pte = walk(pagetable, va, 0)) == 0 || (*pte & PTE_SWAP) == 0)
+    panic("swapin");
+  s = PTE2SLOT(*pte);
+
+  // wait for swapout() to finish writing the slot.
+  acquire(&swap.lock);
+  while(swap.busy[s])
+    sleep(&swap.busy[s], &swap.lock);
+  release(&swap.lock);
+
+  virtio_disk_page(swap.start + s*SWAPBPP, mem, 0);
+  *pte = PA2PTE(mem) | (PTE_FLAGS(*pte) & ~PTE_SWAP) | PTE_V;
+  swapfree(s);
+  return 0;
+}
@@ -5,6 +5,8 @@
 #include "spinlock.h"
 #include "proc.h"
 #include "syscall.h"
+#include "trace.h"
+#include "sysstat.h"
 #include "defs.h"
 
 // Fetch the uint64 at addr from the current process.
@@ -110,10 +112,23 @@ extern uint64 sys_unlink(void);
 extern uint64 sys_link(void);
 extern uint64 sys_mkdir(void);
 extern uint64 sys_close(void);
+extern uint64 sys_ringsetup(void);
+extern uint64 sys_ringenter(void);
+extern uint64 sys_readv(void);
+extern uint64 sys_writev(void);
+extern uint64 sys_pread(void);
+extern uint64 sys_pwrite(void);
+extern uint64 sys_poll(void);
+extern uint64 sys_fcntl(void);
+extern uint64 sys_spawn(void);
+extern uint64 sys_sysstat(void);
+extern uint64 sys_perfopen(void);
+extern uint64 sys_perfread(void);
+extern uint64 sys_getprocinfo(void);
 
 // An array mapping syscall numbers from syscall.h
 // to the function that handles the system call.
-static uint64 (*syscalls[])(void) = {
+static uint64 (*syscalls[NSYSCALL])(void) = {
 [SYS_fork]    sys_fork,
 [SYS_exit]    sys_exit,
 [SYS_wait]    sys_wait,
@@ -135,19 +150,128 @@ static uint64 (*syscalls[])(void) = {
 [SYS_link]    sys_link,
 [SYS_mkdir]   sys_mkdir,
 [SYS_close]   sys_close,
+[SYS_ringsetup] sys_ringsetup,
+[SYS_ringenter] sys_ringenter,
+[SYS_readv]   sys_readv,
+[SYS_writev]  sys_writev,
+[SYS_pread]   sys_pread,
+[SYS_pwrite]  sys_pwrite,
+[SYS_poll]    sys_poll,
+[SYS_fcntl]   sys_fcntl,
+[SYS_spawn]   sys_spawn,
+[SYS_sysstat] sys_sysstat,
+[SYS_perfopen] sys_perfopen,
+[SYS_perfread] sys_perfread,
+[SYS_getprocinfo] sys_getprocinfo,
 };
 
+static char *syscallnames[NSYSCALL] = {
+[SYS_fork]    "fork",
+[SYS_exit]    "exit",
+[SYS_wait]    "wait",
+[SYS_pipe]    "pipe",
+[SYS_read]    "read",
+[SYS_kill]    "kill",
+[SYS_exec]    "exec",
+[SYS_fstat]   "fstat",
+[SYS_chdir]   "chdir",
+[SYS_dup]     "dup",
+[SYS_getpid]  "getpid",
+[SYS_sbrk]    "sbrk",
+[SYS_sleep]   "sleep",
+[SYS_uptime]  "uptime",
+[SYS_open]    "open",
+[SYS_write]   "write",
+[SYS_mknod]   "mknod",
+[SYS_unlink]  "unlink",
+[SYS_link]    "link",
+[SYS_mkdir]   "mkdir",
+[SYS_close]   "close",
+[SYS_ringsetup] "ringsetup",
+[SYS_ringenter] "ringenter",
+[SYS_readv]   "readv",
+[SYS_writev]  "writev",
+[SYS_pread]   "pread",
+[SYS_pwrite]  "pwrite",
+[SYS_poll]    "poll",
+[SYS_fcntl]   "fcntl",
+[SYS_spawn]   "spawn",
+[SYS_sysstat] "sysstat",
+[SYS_perfopen] "perfopen",
+[SYS_perfread] "perfread",
+[SYS_getprocinfo] "getprocinfo",
+};
+
+// System call statistics for all processes. Each CPU keeps
+// its own, so that counting a call takes no lock and no
+// cache line bounces between CPUs; syscallstat() adds them
+// up.
+static struct sysstat cpustat[NCPU][NSYSCALL];
+
+// Count a call to system call num by p that took t ticks.
+static void
+sysaccount(struct proc *p, int num, uint64 t)
+{
+  struct sysstat *st;
+  struct sysacct *a;
+  int i;
+
+  for(i = 0; i < NSYSHIST-1 && (t >> (i+1)) != 0; i++)
+    ;
+  push_off();
+  st = &cpustat[cpuid()][num];
+  st->count++;
+  st->time += t;
+  if(t > st->max)
+    st->max = t;
+  st->hist[i]++;
+  pop_off();
+
+  // only p writes its own accounting.
+  a = &p->sysacct[num];
+  a->count++;
+  a->time += t;
+  if(t > a->max)
+    a->max = t;
+}
+
+// Fill in *st with the statistics for system call num,
+// summed over all CPUs.
+void
+syscallstat(int num, struct sysstat *st)
+{
+  struct sysstat *c;
+  int i;
+
+  memset(st, 0, sizeof(*st));
+  if(syscallnames[num])
+    safestrcpy(st->name, syscallnames[num], sizeof(st->name));
+  for(c = &cpustat[0][num]; c < &cpustat[NCPU][num]; c += NSYSCALL){
+    st->count += c->count;
+    st->time += c->time;
+    if(c->max > st->max)
+      st->max = c->max;
+    for(i = 0; i < NSYSHIST; i++)
+      st->hist[i] += c->hist[i];
+  }
+}
+
 void
 syscall(void)
 {
   int num;
+  uint64 t0;
   struct proc *p = myproc();
 
   num = p->trapframe->a7;
   if(num > 0 && num < NELEM(syscalls) && syscalls[num]) {
     // Use num to lookup the system call function for num, call it,
     // and store its return value in p->trapframe->a0
+    TRACE(TR_SYSENTER, num, 0);
+    t0 = r_time();
     p->trapframe->a0 = syscalls[num]();
+    sysaccount(p, num, r_time() - t0);
+    TRACE(TR_SYSEXIT, num, p->trapframe->a0);
   } else {
     printf("%d %s: unknown sys call %d\n",
             p->pid, p->name, num);
@@ -20,3 +20,16 @@
 #define SYS_link   19
 #define SYS_mkdir  20
 #define SYS_close  21
+#define SYS_ringsetup 22
+#define SYS_ringenter 23
+#define SYS_readv  24
+#define SYS_writev 25
+#define SYS_pread  26
+#define SYS_pwrite 27
+#define SYS_poll   28
+#define SYS_fcntl  29
+#define SYS_spawn  30
+#define SYS_sysstat 31
+#define SYS_perfopen 32
+#define SYS_perfread 33
+#define SYS_getprocinfo 34
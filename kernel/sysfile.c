@@ -15,6 +15,16 @@
 #include "sleeplock.h"
 #include "file.h"
 #include "fcntl.h"
+#include "memlayout.h"
+#include "ring.h"
+#include "poll.h"
+
+// The open file for file descriptor fd, or 0.
+static struct file*
+fdfile(int fd)
+{
+  return fdget(myproc(), fd);
+}
 
 // Fetch the nth word-sized system call argument as a file descriptor
 // and return both the descriptor and the corresponding struct file.
@@ -25,7 +35,7 @@ argfd(int n, int *pfd, struct file **pf)
   struct file *f;
 
   argint(n, &fd);
-  if(fd < 0 || fd >= NOFILE || (f=myproc()->ofile[fd]) == 0)
+  if((f = fdfile(fd)) == 0)
     return -1;
   if(pfd)
     *pfd = fd;
@@ -34,25 +44,6 @@ argfd(int n, int *pfd, struct file **pf)
   return 0;
 }
 
-// Allocate a file descriptor for the given file.
-// Takes over file reference from caller on success.
-static int
-fdalloc(struct file *f)
-{
-  int fd;
-  struct proc *p = myproc();
-
-  // プロセスは NOFILE 個のファイルまで開ける
-  // 開いたファイルの file 構造体は proc.ofile に記録されている
-  for(fd = 0; fd < NOFILE; fd++){
-    if(p->ofile[fd] == 0){
-      p->ofile[fd] = f;
-      return fd;
-    }
-  }
-  return -1;
-}
-
 uint64
 sys_dup(void)
 {
@@ -61,7 +52,7 @@ sys_dup(void)
 
   if(argfd(0, 0, &f) < 0)
     return -1;
-  if((fd=fdalloc(f)) < 0)
+  if((fd=fdalloc(myproc(), f)) < 0)
     return -1;
   filedup(f);
   return fd;
@@ -96,6 +87,93 @@ sys_write(void)
   return filewrite(f, p, n);
 }
 
+// Fetch an array of iovcnt struct iovecs from user address
+// addr into iov, for readv() and writev().
+static int
+fetchiov(uint64 addr, int iovcnt, struct iovec *iov)
+{
+  uint64 tot = 0;
+
+  if(iovcnt < 0 || iovcnt > MAXIOV)
+    return -1;
+  if(copyin(myproc()->pagetable, (char*)iov, addr, iovcnt*sizeof(struct iovec)) < 0)
+    return -1;
+  // the total must fit in the int that readv/writev return.
+  for(int i = 0; i < iovcnt; i++){
+    if(iov[i].iov_len > 0x7fffffff || (tot += iov[i].iov_len) > 0x7fffffff)
+      return -1;
+  }
+  return 0;
+}
+
+uint64
+sys_readv(void)
+{
+  struct file *f;
+  struct iovec iov[MAXIOV];
+  int iovcnt;
+  uint64 p;
+
+  argaddr(1, &p);
+  argint(2, &iovcnt);
+  if(argfd(0, 0, &f) < 0 || fetchiov(p, iovcnt, iov) < 0)
+    return -1;
+  return filereadv(f, iov, iovcnt, -1);
+}
+
+uint64
+sys_writev(void)
+{
+  struct file *f;
+  struct iovec iov[MAXIOV];
+  int iovcnt;
+  uint64 p;
+
+  argaddr(1, &p);
+  argint(2, &iovcnt);
+  if(argfd(0, 0, &f) < 0 || fetchiov(p, iovcnt, iov) < 0)
+    return -1;
+  return filewritev(f, iov, iovcnt, -1);
+}
+
+// read at an explicit offset, leaving f->off alone.
+uint64
+sys_pread(void)
+{
+  struct file *f;
+  struct iovec iov;
+  int n, off;
+  uint64 p;
+
+  argaddr(1, &p);
+  argint(2, &n);
+  argint(3, &off);
+  if(argfd(0, 0, &f) < 0 || n < 0 || off < 0)
+    return -1;
+  iov.iov_base = (void*)p;
+  iov.iov_len = n;
+  return filereadv(f, &iov, 1, off);
+}
+
+// write at an explicit offset, leaving f->off alone.
+uint64
+sys_pwrite(void)
+{
+  struct file *f;
+  struct iovec iov;
+  int n, off;
+  uint64 p;
+
+  argaddr(1, &p);
+  argint(2, &n);
+  argint(3, &off);
+  if(argfd(0, 0, &f) < 0 || n < 0 || off < 0)
+    return -1;
+  iov.iov_base = (void*)p;
+  iov.iov_len = n;
+  return filewritev(f, &iov, 1, off);
+}
+
 uint64
 sys_close(void)
 {
@@ -104,7 +182,7 @@ sys_close(void)
 
   if(argfd(0, &fd, &f) < 0)
     return -1;
-  myproc()->ofile[fd] = 0;
+  fdclear(myproc(), fd);
   fileclose(f);
   return 0;
 }
@@ -337,23 +415,21 @@ create(char *path, short type, short major, short minor)
   return 0;
 }
 
-// いわゆる open だが、単純に create を使うだけではない
-uint64
-sys_open(void)
+// Open path, already copied in from user space, and
+// return a new open file for it, or 0.
+static struct file*
+openfile(char *path, int omode)
 {
-  char path[MAXPATH];
-  int fd, omode;
   struct file *f;
   struct inode *ip;
-  int n;
-
-  // open 時のモードを omode に取り出す
-  argint(1, &omode);
-  // 開くファイルのパスをコピー
-  if((n = argstr(0, path, MAXPATH)) < 0)
-    return -1;
+  int tx;
 
-  begin_op();
+  // only creating or truncating writes to the disk. other
+  // opens are read-only and hold no transaction, so that they
+  // don't hold up commits; see iput().
+  tx = (omode & (O_CREATE|O_TRUNC)) != 0;
+  if(tx)
+    begin_op();
 
   if(omode & O_CREATE){
     // CREATE フラグつきで open しようとした場合
@@ -361,22 +437,25 @@ sys_open(void)
     // todo: なぜ固定で T_FILE?
     ip = create(path, T_FILE, 0, 0);
     if(ip == 0){
-      end_op();
-      return -1;
+      if(tx)
+        end_op();
+      return 0;
     }
   } else {
     // CREATE フラグがない open の場合、既存のファイルを開く
     if((ip = namei(path)) == 0){
-      end_op();
-      return -1;
+      if(tx)
+        end_op();
+      return 0;
     }
     ilock(ip);
     // 指定されたパスの inode がディレクトリだった場合は
     // 読み取り専用として開いていなかったらエラー
     if(ip->type == T_DIR && omode != O_RDONLY){
       iunlockput(ip);
-      end_op();
-      return -1;
+      if(tx)
+        end_op();
+      return 0;
     }
   }
 
@@ -385,18 +464,17 @@ sys_open(void)
   // 開いたものがデバイスファイルの場合、メジャー番号が正しいことを確認
   if(ip->type == T_DEVICE && (ip->major < 0 || ip->major >= NDEV)){
     iunlockput(ip);
-    end_op();
-    return -1;
+    if(tx)
+      end_op();
+    return 0;
   }
 
   // ファイルを確保
-  // 成功したら、さらにプロセスが開いたファイルとしてそれを登録
-  if((f = filealloc()) == 0 || (fd = fdalloc(f)) < 0){
-    if(f)
-      fileclose(f);
+  if((f = filealloc()) == 0){
     iunlockput(ip);
-    end_op();
-    return -1;
+    if(tx)
+      end_op();
+    return 0;
   }
 
   if(ip->type == T_DEVICE){
@@ -413,6 +491,7 @@ sys_open(void)
   f->readable = !(omode & O_WRONLY);
   // 書き込み専用モードか、読み書きモードだったら書き込める
   f->writable = (omode & O_WRONLY) || (omode & O_RDWR);
+  f->nonblock = (omode & O_NONBLOCK) != 0;
 
   // TRUNC フラグがついていたら itrunc を呼ぶ、つまりファイルを削除する
   // todo: どういう状況？
@@ -421,11 +500,46 @@ sys_open(void)
   }
 
   iunlock(ip);
-  end_op();
+  if(tx)
+    end_op();
+
+  return f;
+}
+
+// Open path, already copied in from user space, and
+// return a new file descriptor for it, or -1.
+static int
+openpath(char *path, int omode)
+{
+  int fd;
+  struct file *f;
 
+  if((f = openfile(path, omode)) == 0)
+    return -1;
+  // プロセスが開いたファイルとして登録
+  if((fd = fdalloc(myproc(), f)) < 0){
+    fileclose(f);
+    return -1;
+  }
   return fd;
 }
 
+// いわゆる open だが、単純に create を使うだけではない
+uint64
+sys_open(void)
+{
+  char path[MAXPATH];
+  int omode;
+
+  // open 時のモードを omode に取り出す
+  argint(1, &omode);
+  // 開くファイルのパスをコピー
+  if(argstr(0, path, MAXPATH) < 0)
+    return -1;
+
+  return openpath(path, omode);
+}
+
 // いわゆる mkdir
 uint64
 sys_mkdir(void)
@@ -475,40 +589,41 @@ sys_chdir(void)
   struct inode *ip;
   struct proc *p = myproc();
   
-  begin_op();
+  // a read-only operation: no transaction; see iput().
   if(argstr(0, path, MAXPATH) < 0 || (ip = namei(path)) == 0){
-    end_op();
     return -1;
   }
   ilock(ip);
   if(ip->type != T_DIR){
     iunlockput(ip);
-    end_op();
     return -1;
   }
   iunlock(ip);
   iput(p->cwd);
-  end_op();
   p->cwd = ip;
   return 0;
 }
 
-uint64
-sys_exec(void)
+// 引数用に確保したページをすべて開放
+static void
+freeargv(char **argv)
+{
+  for(int i = 0; i < MAXARG && argv[i] != 0; i++)
+    kfree(argv[i]);
+}
+
+// Copy in the user's null-terminated argument array at uargv
+// for exec(). argv must have MAXARG entries. On success, the
+// caller must freeargv(argv).
+static int
+fetchargv(uint64 uargv, char **argv)
 {
-  // argv はカーネル内で確保しているので、仮想アドレスと物理アドレスが同じかも
-  // 配列自体はスタックに確保、中身は kalloc で確保
-  char path[MAXPATH], *argv[MAXARG];
   int i;
-  uint64 uargv, uarg;
+  uint64 uarg;
 
-  argaddr(1, &uargv);
-  if(argstr(0, path, MAXPATH) < 0) {
-    return -1;
-  }
-  memset(argv, 0, sizeof(argv));
+  memset(argv, 0, MAXARG*sizeof(char*));
   for(i=0;; i++){
-    if(i >= NELEM(argv)){
+    if(i >= MAXARG){
       goto bad;
     }
     if(fetchaddr(uargv+sizeof(uint64)*i, (uint64*)&uarg) < 0){
@@ -525,18 +640,115 @@ sys_exec(void)
     if(fetchstr(uarg, argv[i], PGSIZE) < 0)
       goto bad;
   }
+  return 0;
 
-  int ret = exec(path, argv);
+ bad:
+  freeargv(argv);
+  return -1;
+}
 
-  // 引数用に確保したページをすべて開放
-  for(i = 0; i < NELEM(argv) && argv[i] != 0; i++)
-    kfree(argv[i]);
+uint64
+sys_exec(void)
+{
+  // argv はカーネル内で確保しているので、仮想アドレスと物理アドレスが同じかも
+  // 配列自体はスタックに確保、中身は kalloc で確保
+  char path[MAXPATH], *argv[MAXARG];
+  uint64 uargv;
 
+  argaddr(1, &uargv);
+  if(argstr(0, path, MAXPATH) < 0) {
+    return -1;
+  }
+  if(fetchargv(uargv, argv) < 0)
+    return -1;
+
+  int ret = exec(path, argv);
+
+  freeargv(argv);
   return ret;
+}
+
+// Carry out one of spawn()'s file actions on np, the child.
+static int
+spawnaction(struct proc *np, struct spawnfa *fa)
+{
+  char path[MAXPATH];
+  struct file *f, *of;
+
+  if(fa->fd < 0 || fa->fd >= MAXFD)
+    return -1;
+  switch(fa->op){
+  case SPAWN_OPEN:
+    if(fetchstr((uint64)fa->path, path, MAXPATH) < 0 ||
+       (f = openfile(path, fa->arg)) == 0)
+      return -1;
+    break;
+  case SPAWN_DUP:
+    if((f = fdget(np, fa->arg)) == 0)
+      return -1;
+    if(fa->arg == fa->fd)
+      return 0;
+    filedup(f);
+    break;
+  case SPAWN_CLOSE:
+    f = 0;
+    break;
+  default:
+    return -1;
+  }
+  if((of = fdclear(np, fa->fd)) != 0)
+    fileclose(of);
+  if(f && fdinstall(np, fa->fd, f) < 0){
+    fileclose(f);
+    return -1;
+  }
+  return 0;
+}
+
+// Start a new process running path, without copying the
+// caller's memory as fork() would. The child gets the caller's
+// open files and current directory, altered by nfa file actions
+// that the caller passes in fa, and is its child as if forked.
+// Returns the child's pid, or -1.
+uint64
+sys_spawn(void)
+{
+  char path[MAXPATH], *argv[MAXARG];
+  struct spawnfa fa;
+  struct proc *np;
+  uint64 uargv, ufa;
+  int nfa, i, argc, pid;
+
+  argaddr(1, &uargv);
+  argaddr(2, &ufa);
+  argint(3, &nfa);
+  if(nfa < 0 || nfa > MAXSPAWNFA || argstr(0, path, MAXPATH) < 0)
+    return -1;
+  if(fetchargv(uargv, argv) < 0)
+    return -1;
+  if((np = spawnalloc()) == 0){
+    freeargv(argv);
+    return -1;
+  }
+
+  for(i = 0; i < nfa; i++){
+    if(copyin(myproc()->pagetable, (char*)&fa, ufa + i*sizeof(fa), sizeof(fa)) < 0 ||
+       spawnaction(np, &fa) < 0)
+      goto bad;
+  }
+  if((argc = execproc(np, path, argv)) < 0)
+    goto bad;
+  freeargv(argv);
+
+  // argc, like exec()'s return value.
+  np->trapframe->a0 = argc;
+  pid = np->pid;
+  procstart(np);
+  return pid;
 
  bad:
-  for(i = 0; i < NELEM(argv) && argv[i] != 0; i++)
-    kfree(argv[i]);
+  freeargv(argv);
+  spawnfree(np);
   return -1;
 }
 
@@ -556,10 +768,10 @@ sys_pipe(void)
   fd0 = -1;
   // pipealloc で確保した2つのファイル構造体にファイルディスクリプタを割り当て
   // fdalloc 内で、プロセス構造体の ofile に登録される
-  if((fd0 = fdalloc(rf)) < 0 || (fd1 = fdalloc(wf)) < 0){
+  if((fd0 = fdalloc(p, rf)) < 0 || (fd1 = fdalloc(p, wf)) < 0){
     // 失敗したら片付けしてから終了
     if(fd0 >= 0)
-      p->ofile[fd0] = 0;
+      fdclear(p, fd0);
     fileclose(rf);
     fileclose(wf);
     return -1;
@@ -568,11 +780,212 @@ sys_pipe(void)
   // 2つのディスクリプタ fd0 と fd1 を返す
   if(copyout(p->pagetable, fdarray, (char*)&fd0, sizeof(fd0)) < 0 ||
      copyout(p->pagetable, fdarray+sizeof(fd0), (char *)&fd1, sizeof(fd1)) < 0){
-    p->ofile[fd0] = 0;
-    p->ofile[fd1] = 0;
+    fdclear(p, fd0);
+    fdclear(p, fd1);
     fileclose(rf);
     fileclose(wf);
     return -1;
   }
   return 0;
 }
+
+// Map a submission/completion ring page at URING (see ring.h),
+// and return its address.
+uint64
+sys_ringsetup(void)
+{
+  struct proc *p = myproc();
+  struct ring *r;
+
+  if(p->ring)
+    return URING;
+  if((r = (struct ring*)kalloc_zeroed()) == 0)
+    return -1;
+  if(mappages(p->pagetable, URING, PGSIZE, (uint64)r, PTE_R|PTE_W|PTE_U) != 0){
+    kfree((void*)r);
+    return -1;
+  }
+  uvmflush(p->pagetable);
+  p->ring = r;
+  return URING;
+}
+
+// Carry out one ring submission, much as the matching
+// system call would.
+static int
+ringop(struct ringsqe *e)
+{
+  char path[MAXPATH];
+  struct file *f = 0;
+
+  if(e->op != RING_OPEN && (f = fdfile(e->fd)) == 0)
+    return -1;
+
+  switch(e->op){
+  case RING_READ:
+    return fileread(f, e->addr, e->n);
+  case RING_WRITE:
+    return filewrite(f, e->addr, e->n);
+  case RING_OPEN:
+    if(fetchstr(e->addr, path, MAXPATH) < 0)
+      return -1;
+    return openpath(path, e->n);
+  case RING_CLOSE:
+    fdclear(myproc(), e->fd);
+    fileclose(f);
+    return 0;
+  case RING_FSTAT:
+    return filestat(f, e->addr);
+  case RING_FSYNC:
+    // a write is on disk once its log transaction
+    // commits, which may be after it returns.
+    log_sync();
+    return 0;
+  }
+  return -1;
+}
+
+// Drain the submission ring, posting a completion for each
+// entry, so that one trap carries out a whole batch of calls.
+// Stops early if the completion ring fills up.
+// Returns the number of submissions consumed.
+uint64
+sys_ringenter(void)
+{
+  struct proc *p = myproc();
+  struct ring *r = p->ring;
+  struct ringsqe e;
+  struct ringcqe *c;
+  int n = 0;
+
+  if(r == 0)
+    return -1;
+
+  while(r->sqhead != r->sqtail){
+    if(r->sqtail - r->sqhead > RING_NENT)
+      return -1;
+    if(r->cqtail - r->cqhead >= RING_NENT || killed(p))
+      break;
+    // copy the entry, since the process can write the ring.
+    e = r->sq[r->sqhead % RING_NENT];
+    r->sqhead++;
+    c = &r->cq[r->cqtail % RING_NENT];
+    c->data = e.data;
+    c->res = ringop(&e);
+    r->cqtail++;
+    n++;
+  }
+  return n;
+}
+
+// get or set a file descriptor's flags; only O_NONBLOCK
+// can be changed.
+uint64
+sys_fcntl(void)
+{
+  struct file *f;
+  int cmd, arg;
+
+  argint(1, &cmd);
+  argint(2, &arg);
+  if(argfd(0, 0, &f) < 0)
+    return -1;
+
+  switch(cmd){
+  case F_GETFL:
+    return (f->readable && f->writable ? O_RDWR : f->writable ? O_WRONLY : O_RDONLY) |
+           (f->nonblock ? O_NONBLOCK : 0);
+  case F_SETFL:
+    f->nonblock = (arg & O_NONBLOCK) != 0;
+    return 0;
+  }
+  return -1;
+}
+
+// Wait until one of the nfds descriptors in the user's pollfd
+// array is ready, or for timeout ticks (forever if negative).
+// The poller goes on the wait queue of each descriptor's
+// object (see filepoll()) and on tickq if it has a timeout;
+// pollwake() on any of them makes it look again.
+// Returns the number of descriptors with revents set, 0 on
+// timeout, or -1.
+uint64
+sys_poll(void)
+{
+  struct proc *p = myproc();
+  struct {
+    struct pollfd fds[MAXPOLL];
+    struct pollent ents[MAXPOLL];
+    struct pollent tick;
+  } *ps;
+  struct file *f;
+  uint64 addr;
+  int nfds, timeout, i, n, woken;
+  uint t0;
+
+  argaddr(0, &addr);
+  argint(1, &nfds);
+  argint(2, &timeout);
+  if(nfds < 0 || nfds > MAXPOLL)
+    return -1;
+  // too big for the kernel stack.
+  if((ps = kalloc()) == 0)
+    return -1;
+  memset(ps, 0, sizeof(*ps));
+  if(copyin(p->pagetable, (char*)ps->fds, addr, nfds*sizeof(struct pollfd)) < 0){
+    kfree(ps);
+    return -1;
+  }
+
+  ps->tick.woken = &woken;
+  if(timeout > 0){
+    acquire(&tickslock);
+    pollqadd(&tickq, &tickslock, &ps->tick);
+    release(&tickslock);
+  }
+  t0 = ticks;
+
+  for(int first = 1; ; first = 0){
+    acquire(&polllock);
+    woken = 0;
+    release(&polllock);
+
+    // look at every descriptor, and the first time around
+    // join the wait queues, so that nothing that happens
+    // after this look goes unnoticed.
+    n = 0;
+    for(i = 0; i < nfds; i++){
+      struct pollfd *pfd = &ps->fds[i];
+      pfd->revents = 0;
+      if(pfd->fd < 0)
+        continue;
+      if((f = fdfile(pfd->fd)) == 0){
+        pfd->revents = POLLNVAL;
+      } else {
+        ps->ents[i].woken = &woken;
+        pfd->revents = filepoll(f, first ? &ps->ents[i] : 0) & (pfd->events | POLLHUP);
+      }
+      if(pfd->revents)
+        n++;
+    }
+    if(n > 0 || timeout == 0 || (timeout > 0 && ticks - t0 >= timeout))
+      break;
+    if(killed(p)){
+      n = -1;
+      break;
+    }
+
+    acquire(&polllock);
+    while(woken == 0 && !killed(p))
+      sleep(&woken, &polllock);
+    release(&polllock);
+  }
+
+  for(i = 0; i < nfds; i++)
+    pollqdel(&ps->ents[i]);
+  pollqdel(&ps->tick);
+  if(n >= 0 && copyout(p->pagetable, addr, (char*)ps->fds, nfds*sizeof(struct pollfd)) < 0)
+    n = -1;
+  kfree(ps);
+  return n;
+}
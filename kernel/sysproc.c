@@ -5,6 +5,7 @@
 #include "memlayout.h"
 #include "spinlock.h"
 #include "proc.h"
+#include "sysstat.h"
 
 uint64
 sys_exit(void)
@@ -31,8 +32,14 @@ uint64
 sys_wait(void)
 {
   uint64 p;
+  int pid;
+
   argaddr(0, &p);
-  return wait(p);
+  // wait() copies the exit status with spinlocks held.
+  uvmpin(p, sizeof(int));
+  pid = wait(p);
+  uvmunpin();
+  return pid;
 }
 
 uint64
@@ -89,3 +96,53 @@ sys_uptime(void)
   release(&tickslock);
   return xticks;
 }
+
+// sysstat(pid, st, n): fill in st[0..n-1] with statistics
+// for system calls 0 through n-1 made by all processes, if
+// pid is 0, or by process pid. Per-process statistics have
+// no histogram. Returns how many entries were filled in.
+uint64
+sys_sysstat(void)
+{
+  int pid, n, i;
+  uint64 addr;
+  struct sysstat st;
+  struct sysacct a;
+
+  argint(0, &pid);
+  argaddr(1, &addr);
+  argint(2, &n);
+  if(n < 0)
+    return -1;
+  if(n > NSYSCALL)
+    n = NSYSCALL;
+  for(i = 0; i < n; i++){
+    syscallstat(i, &st);
+    if(pid != 0){
+      if(procsysacct(pid, i, &a) < 0)
+        return -1;
+      st.count = a.count;
+      st.time = a.time;
+      st.max = a.max;
+      memset(st.hist, 0, sizeof(st.hist));
+    }
+    if(copyout(myproc()->pagetable, addr + i*sizeof(st), (char*)&st, sizeof(st)) < 0)
+      return -1;
+  }
+  return n;
+}
+
+// getprocinfo(pi, n): describe up to n processes in pi.
+// Returns how many there were.
+uint64
+sys_getprocinfo(void)
+{
+  uint64 addr;
+  int n;
+
+  argaddr(0, &addr);
+  argint(1, &n);
+  if(n < 0)
+    return -1;
+  return procinfo(addr, n);
+}
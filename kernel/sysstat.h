@@ -0,0 +1,12 @@
+// Statistics for one system call, from sysstat().
+// Times are in ticks of the time CSR (see vdso->timebase).
+#define NSYSHIST 24
+
+struct sysstat {
+  char name[16];
+  uint64 count;           // calls
+  uint64 time;            // total time spent in them
+  uint64 max;             // longest call
+  uint64 hist[NSYSHIST];  // calls that took [2^i, 2^(i+1)) ticks, or
+                          // longer for the last; only for all processes
+};
@@ -0,0 +1,168 @@
+//
+// Tracepoints.
+//
+// The kernel calls TRACE() at interesting places: context
+// switches, sleep and wakeup, the buffer cache, the disk, the
+// log, and system call entry and exit. When tracing is on,
+// each TRACE() appends a timestamped struct tracerec to a ring
+// belonging to the CPU it runs on. When tracing is off, a
+// TRACE() costs only a test of the tracing flag.
+//
+// A CPU writes its ring with interrupts off, and only that
+// CPU writes it, so writers need no lock. A ring that is full
+// drops new records, and counts them, until a reader makes
+// room. Readers take trace.lock, since they share the rings'
+// read indices.
+//
+// Tracing is the TRACEDEV device. Writing "1" to it discards old
+// records and turns tracing on; writing "0" turns it off.
+// Reading it returns whole records, merged from all the CPUs'
+// rings in time order, and never waits; a read that finds no
+// records returns 0.
+//
+
+#include "types.h"
+#include "param.h"
+#include "memlayout.h"
+#include "riscv.h"
+#include "spinlock.h"
+#include "sleeplock.h"
+#include "fs.h"
+#include "file.h"
+#include "proc.h"
+#include "trace.h"
+#include "defs.h"
+
+#define NTRACE 1024  // records per CPU awaiting a reader
+
+struct tracering {
+  uint r;        // read index; readers advance it
+  uint w;        // write index; only this CPU advances it
+  uint lost;     // records dropped because the ring was full
+  uint lostseen; // lost as of the last TR_LOST a reader made
+  struct tracerec rec[NTRACE];
+};
+
+volatile int tracing;
+
+struct {
+  struct spinlock lock;
+  struct tracering ring[NCPU];
+} trace;
+
+// Append a record to this CPU's ring. Call through TRACE().
+void
+traceput(int event, uint64 a0, uint64 a1)
+{
+  struct tracering *t;
+  struct tracerec *e;
+  struct proc *p;
+
+  push_off();
+  t = &trace.ring[cpuid()];
+  __sync_synchronize();
+  if(t->w - t->r >= NTRACE){
+    t->lost++;
+  } else {
+    e = &t->rec[t->w % NTRACE];
+    e->time = r_time();
+    e->event = event;
+    e->cpu = cpuid();
+    p = mycpu()->proc;
+    e->pid = p ? p->pid : 0;
+    e->a0 = a0;
+    e->a1 = a1;
+    // publish the record before the new write index.
+    __sync_synchronize();
+    t->w++;
+  }
+  pop_off();
+}
+
+static int
+traceread(int user_dst, uint64 dst, int n, int nonblock)
+{
+  struct tracering *t, *first;
+  struct tracerec lost;
+  uint nlost;
+  int tot = 0, err = 0;
+
+  acquire(&trace.lock);
+  while(n - tot >= sizeof(struct tracerec)){
+    // the ring whose oldest record is oldest.
+    first = 0;
+    for(t = trace.ring; t < trace.ring + NCPU; t++){
+      __sync_synchronize();
+      if(t->r != t->w && (first == 0 ||
+         t->rec[t->r % NTRACE].time < first->rec[first->r % NTRACE].time))
+        first = t;
+    }
+    if(first == 0)
+      break;
+    t = first;
+
+    // tell the reader where records went missing.
+    nlost = t->lost - t->lostseen;
+    if(nlost > 0){
+      lost = t->rec[t->r % NTRACE];
+      lost.event = TR_LOST;
+      lost.a0 = nlost;
+      lost.a1 = 0;
+      if(either_copyout(user_dst, dst + tot, &lost, sizeof(lost)) < 0){
+        err = 1;
+        break;
+      }
+      t->lostseen += nlost;
+      tot += sizeof(lost);
+      continue;
+    }
+
+    if(either_copyout(user_dst, dst + tot, &t->rec[t->r % NTRACE],
+                      sizeof(struct tracerec)) < 0){
+      err = 1;
+      break;
+    }
+    // done with the slot before the writer may reuse it.
+    __sync_synchronize();
+    t->r++;
+    tot += sizeof(struct tracerec);
+  }
+  release(&trace.lock);
+  if(tot == 0 && err)
+    return -1;
+  return tot;
+}
+
+static int
+tracewrite(int user_src, uint64 src, int n)
+{
+  struct tracering *t;
+  char c;
+
+  if(n < 1 || either_copyin(&c, user_src, src, 1) < 0)
+    return -1;
+  if(c == '1'){
+    tracing = 0;
+    acquire(&trace.lock);
+    for(t = trace.ring; t < trace.ring + NCPU; t++){
+      t->r = t->w;
+      t->lostseen = t->lost;
+    }
+    release(&trace.lock);
+    __sync_synchronize();
+    tracing = 1;
+  } else if(c == '0'){
+    tracing = 0;
+  } else {
+    return -1;
+  }
+  return n;
+}
+
+void
+traceinit(void)
+{
+  initlock(&trace.lock, "trace");
+  devsw[TRACEDEV].read = traceread;
+  devsw[TRACEDEV].write = tracewrite;
+}
@@ -0,0 +1,26 @@
+// Trace records, as read from the TRACEDEV device.
+// See trace.c.
+struct tracerec {
+  uint64 time;    // time CSR when the event happened
+  ushort event;   // TR_*
+  ushort cpu;
+  int pid;        // current process, or 0 in the scheduler
+  uint64 a0;      // event-specific arguments
+  uint64 a1;
+};
+
+// events, and what a0 and a1 hold.
+#define TR_LOST       1  // a0 records this cpu dropped before this one
+#define TR_SWITCH     2  // scheduler switches to process a0
+#define TR_SLEEP      3  // sleep on channel a0
+#define TR_WAKEUP     4  // process a1 woken from channel a0
+#define TR_BHIT       5  // bread() found block a0 cached
+#define TR_BMISS      6  // bread() must read block a0
+#define TR_BRELSE     7  // block a0 released
+#define TR_DISKSTART  8  // disk request for block a0 submitted; a1 = write
+#define TR_DISKDONE   9  // disk request for block a0 completed
+#define TR_BEGINOP   10  // begin_op() admitted a file system operation
+#define TR_ENDOP     11  // end_op()
+#define TR_COMMIT    12  // commit of a0 logged blocks starts
+#define TR_SYSENTER  13  // system call a0
+#define TR_SYSEXIT   14  // system call a0 returns a1
@@ -5,11 +5,17 @@
 #include "spinlock.h"
 #include "proc.h"
 #include "defs.h"
+#include "poll.h"
 
 struct spinlock tickslock;
 uint ticks;
+struct vdso *vdso;  // mapped read-only at VDSO in every process
+struct pollq tickq; // poll() calls with a timeout; under tickslock
 
 extern char trampoline[], uservec[], userret[];
+#ifdef SHAREDPT
+extern char ucopyend[], ufault[];  // uaccess.S
+#endif
 
 // in kernelvec.S, calls kerneltrap().
 void kernelvec();
@@ -20,6 +26,11 @@ void
 trapinit(void)
 {
   initlock(&tickslock, "time");
+
+  if((vdso = (struct vdso*)kalloc()) == 0)
+    panic("trapinit: vdso");
+  memset(vdso, 0, PGSIZE);
+  vdso->timebase = TIMEBASE;
 }
 
 // set up to take exceptions and traps while in the kernel.
@@ -53,6 +64,11 @@ usertrap(void)
   
   // save user program counter.
   p->trapframe->epc = r_sepc();
+
+  // p has been in user space since usertrapret().
+  uint64 now = r_time();
+  p->acct.utime += now - p->acct.stamp;
+  p->acct.stamp = now;
   
   if(r_scause() == 8){
     // system call
@@ -71,6 +87,19 @@ usertrap(void)
     syscall();
   } else if((which_dev = devintr()) != 0){
     // ok
+  } else if(r_scause() == 12 || r_scause() == 13 || r_scause() == 15){
+    // page fault: the stack grew into a new page, or the page
+    // was swapped out, which means waiting for the disk with
+    // interrupts on, once we're done with scause and stval.
+    uint64 scause = r_scause();
+    uint64 va = r_stval();
+    intr_on();
+    if(uvmfault(p->pagetable, va) < 0){
+      p->acct.faults++;
+      printf("usertrap(): unexpected scause %p pid=%d\n", scause, p->pid);
+      printf("            sepc=%p stval=%p\n", p->trapframe->epc, va);
+      setkilled(p);
+    }
   } else {
     printf("usertrap(): unexpected scause %p pid=%d\n", r_scause(), p->pid);
     printf("            sepc=%p stval=%p\n", r_sepc(), r_stval());
@@ -100,6 +129,12 @@ usertrapret(void)
   // we're back in user space, where usertrap() is correct.
   intr_off();
 
+  // p has been in the kernel since usertrap() or the
+  // scheduler started it.
+  uint64 now = r_time();
+  p->acct.stime += now - p->acct.stamp;
+  p->acct.stamp = now;
+
   // send syscalls, interrupts, and exceptions to uservec in trampoline.S
   uint64 trampoline_uservec = TRAMPOLINE + (uservec - trampoline);
   w_stvec(trampoline_uservec);
@@ -124,7 +159,7 @@ usertrapret(void)
   w_sepc(p->trapframe->epc);
 
   // tell trampoline.S the user page table to switch to.
-  uint64 satp = MAKE_SATP(p->pagetable);
+  uint64 satp = uvmsatp(p);
 
   // jump to userret in trampoline.S at the top of memory, which 
   // switches to the user page table, restores user registers,
@@ -150,6 +185,26 @@ kerneltrap()
   if(intr_get() != 0)
     panic("kerneltrap: interrupts enabled");
 
+#ifdef SHAREDPT
+  // a page fault in ucopy() or ucopystr() is either the user
+  // stack growing or a swapped-out page, in which case the copy
+  // tries again, or a bad user address: resume at ufault, which
+  // makes the copy fail. swapping in waits for the disk, so
+  // let interrupts in if the copy had them on.
+  if((scause == 13 || scause == 15) &&
+     sepc >= (uint64)ucopy && sepc < (uint64)ucopyend){
+    uint64 va = r_stval();
+    int r;
+    if(sstatus & SSTATUS_SPIE)
+      intr_on();
+    r = uvmfault(myproc()->pagetable, va);
+    intr_off();
+    w_sepc(r == 0 ? sepc : (uint64)ufault);
+    w_sstatus(sstatus);
+    return;
+  }
+#endif
+
   // カーネルの処理を実行中に発生した例外がデバイス割込みでなかった場合は
   // カーネルの処理で異常が発生したということなので、諦めて panic する
   if((which_dev = devintr()) == 0){
@@ -161,8 +216,14 @@ kerneltrap()
   // スケジューラ以外のカーネル処理(システムコールとか)を実行中だったら
   // yield を呼び出して CPU を他のプロセスに譲る
   // give up the CPU if this is a timer interrupt.
-  if(which_dev == 2 && myproc() != 0 && myproc()->state == RUNNING)
+  // the code interrupted may be using one of the process's
+  // pages by its physical address; swapout() must leave them
+  // alone until it runs again.
+  if(which_dev == 2 && myproc() != 0 && myproc()->state == RUNNING){
+    myproc()->vmpin++;
     yield();
+    myproc()->vmpin--;
+  }
 
   // 控えておいた sepc/sstatus レジスタを復帰
   // the yield() may have caused some traps to occur,
@@ -176,7 +237,9 @@ clockintr()
 {
   acquire(&tickslock);
   ticks++;
+  vdso->ticks = ticks;
   wakeup(&ticks);
+  pollwake(&tickq);
   release(&tickslock);
 }
 
@@ -253,6 +316,7 @@ devintr()
     if(cpuid() == 0){
       clockintr();
     }
+    profintr();
     
     // acknowledge the software interrupt by clearing
     // the SSIP bit in sip.
@@ -7,6 +7,8 @@
 
 #include "types.h"
 #include "riscv.h"
+#include "trace.h"
+#include "iostat.h"
 #include "defs.h"
 #include "param.h"
 #include "memlayout.h"
@@ -48,8 +50,10 @@ static struct disk {
   // for use when completion interrupt arrives.
   // indexed by first descriptor index of chain.
   struct {
-    struct buf *b;
+    int *busy;     // cleared when the request is done
+    uint blockno;
     char status;
+    uint64 start;  // time submitted
   } info[NUM];
 
   // disk command headers.
@@ -57,6 +61,15 @@ static struct disk {
   struct virtio_blk_req ops[NUM];
   
   struct spinlock vdisk_lock;
+
+  // statistics; see struct iostats.
+  uint64 reads;
+  uint64 writes;
+  uint64 bytes;
+  uint64 inflight;
+  uint64 maxinflight;
+  uint64 time;
+  uint64 hist[NIOHIST];
   
 } disk;
 
@@ -216,11 +229,14 @@ alloc3_desc(int *idx)
   return 0;
 }
 
+// Transfer len bytes at data to or from the disk, starting at
+// block blockno, and wait until the disk is done. *busy is set
+// for as long as the request is in flight.
 // write が 0 以外なら書き込み、そうでなければ読み込み
-void
-virtio_disk_rw(struct buf *b, int write)
+static void
+diskrw(uint blockno, void *data, uint len, int write, int *busy)
 {
-  uint64 sector = b->blockno * (BSIZE / 512);
+  uint64 sector = blockno * (BSIZE / 512);
 
   acquire(&disk.vdisk_lock);
 
@@ -256,12 +272,12 @@ virtio_disk_rw(struct buf *b, int write)
   disk.desc[idx[0]].flags = VRING_DESC_F_NEXT;
   disk.desc[idx[0]].next = idx[1];
 
-  disk.desc[idx[1]].addr = (uint64) b->data;
-  disk.desc[idx[1]].len = BSIZE;
+  disk.desc[idx[1]].addr = (uint64) data;
+  disk.desc[idx[1]].len = len;
   if(write)
-    disk.desc[idx[1]].flags = 0; // device reads b->data
+    disk.desc[idx[1]].flags = 0; // device reads data
   else
-    disk.desc[idx[1]].flags = VRING_DESC_F_WRITE; // device writes b->data
+    disk.desc[idx[1]].flags = VRING_DESC_F_WRITE; // device writes data
   disk.desc[idx[1]].flags |= VRING_DESC_F_NEXT;
   disk.desc[idx[1]].next = idx[2];
 
@@ -271,9 +287,10 @@ virtio_disk_rw(struct buf *b, int write)
   disk.desc[idx[2]].flags = VRING_DESC_F_WRITE; // device writes the status
   disk.desc[idx[2]].next = 0;
 
-  // record struct buf for virtio_disk_intr().
-  b->disk = 1;
-  disk.info[idx[0]].b = b;
+  // record the request for virtio_disk_intr().
+  *busy = 1;
+  disk.info[idx[0]].busy = busy;
+  disk.info[idx[0]].blockno = blockno;
 
   // tell the device the first index in our chain of descriptors.
   disk.avail->ring[disk.avail->idx % NUM] = idx[0];
@@ -286,18 +303,57 @@ virtio_disk_rw(struct buf *b, int write)
   __sync_synchronize();
 
   *R(VIRTIO_MMIO_QUEUE_NOTIFY) = 0; // value is queue number
+  TRACE(TR_DISKSTART, blockno, write);
+  disk.info[idx[0]].start = r_time();
+  if(write)
+    disk.writes++;
+  else
+    disk.reads++;
+  disk.bytes += len;
+  if(++disk.inflight > disk.maxinflight)
+    disk.maxinflight = disk.inflight;
 
   // Wait for virtio_disk_intr() to say request has finished.
-  while(b->disk == 1) {
-    sleep(b, &disk.vdisk_lock);
+  while(*busy) {
+    sleep(busy, &disk.vdisk_lock);
   }
 
-  disk.info[idx[0]].b = 0;
+  disk.info[idx[0]].busy = 0;
   free_chain(idx[0]);
 
   release(&disk.vdisk_lock);
 }
 
+void
+virtio_disk_rw(struct buf *b, int write)
+{
+  diskrw(b->blockno, b->data, BSIZE, write, &b->disk);
+}
+
+// Read or write a whole page, starting at block blockno.
+// For swap.c.
+void
+virtio_disk_page(uint blockno, void *page, int write)
+{
+  int busy;
+
+  diskrw(blockno, page, PGSIZE, write, &busy);
+}
+
+// Count a request that took t ticks.
+// Caller must hold disk.vdisk_lock.
+static void
+diskdone(uint64 t)
+{
+  int i;
+
+  for(i = 0; i < NIOHIST-1 && (t >> (i+1)) != 0; i++)
+    ;
+  disk.hist[i]++;
+  disk.time += t;
+  disk.inflight--;
+}
+
 void
 virtio_disk_intr()
 {
@@ -323,12 +379,29 @@ virtio_disk_intr()
     if(disk.info[id].status != 0)
       panic("virtio_disk_intr status");
 
-    struct buf *b = disk.info[id].b;
-    b->disk = 0;   // disk is done with buf
-    wakeup(b);
+    int *busy = disk.info[id].busy;
+    *busy = 0;   // disk is done with the request's data
+    TRACE(TR_DISKDONE, disk.info[id].blockno, 0);
+    diskdone(r_time() - disk.info[id].start);
+    wakeup(busy);
 
     disk.used_idx += 1;
   }
 
   release(&disk.vdisk_lock);
 }
+
+// Add the disk's statistics to *st.
+void
+diskstats(struct iostats *st)
+{
+  acquire(&disk.vdisk_lock);
+  st->dreads = disk.reads;
+  st->dwrites = disk.writes;
+  st->dbytes = disk.bytes;
+  st->dinflight = disk.inflight;
+  st->dmaxinflight = disk.maxinflight;
+  st->dtime = disk.time;
+  memmove(st->dhist, disk.hist, sizeof(st->dhist));
+  release(&disk.vdisk_lock);
+}
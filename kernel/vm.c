@@ -3,6 +3,8 @@
 #include "memlayout.h"
 #include "elf.h"
 #include "riscv.h"
+#include "spinlock.h"
+#include "proc.h"
 #include "defs.h"
 #include "fs.h"
 
@@ -15,6 +17,31 @@ extern char etext[];  // kernel.ld sets this to end of kernel code.
 
 extern char trampoline[]; // trampoline.S
 
+// Address-space identifiers.
+//
+// Each user page table runs under its own ASID, so the TLB
+// can hold translations for the kernel and for several
+// processes at once, and neither traps nor context switches
+// need to flush it. ASID 0 belongs to the kernel page table.
+//
+// ASIDs are handed out in order. When they run out, a new
+// generation starts: every hart must flush its whole TLB
+// before it next runs user code, and a process holding an
+// ASID from an older generation gets a fresh one the next
+// time it runs. See uvmsatp().
+//
+// A hart that implements no ASID bits runs everything as
+// ASID 0, and trampoline.S flushes the TLB on every switch.
+struct {
+  struct spinlock lock;
+  uint64 max;                 // largest ASID the harts implement
+  uint64 next;                // next unused ASID in this generation
+  volatile uint64 generation; // counts rollovers, starting at 1
+} asids;
+
+#define ASIDGEN(a) ((a) >> 16)
+#define ASIDNUM(a) ((a) & SATP_ASID_MASK)
+
 // xv6 では、カーネルはダイレクトマッピング(物理アドレス=仮想アドレス)になっている
 // Make a direct-map page table for the kernel.
 pagetable_t
@@ -48,18 +75,80 @@ kvmmake(void)
   // the highest virtual address in the kernel.
   kvmmap(kpgtbl, TRAMPOLINE, (uint64)trampoline, PGSIZE, PTE_R | PTE_X);
 
-  // 各プロセス用のページテーブル用ページを確保し、カーネルの仮想アドレス空間にマップする
-  // allocate and map a kernel stack for each process.
-  proc_mapstacks(kpgtbl);
-  
+  // kernel stacks are mapped as struct procs are made, by
+  // kvmstack(). make the page-table pages above them now, so
+  // that kvmshare() shares them.
+  if(walk(kpgtbl, KSTACK(0), 1) == 0)
+    panic("kvmmake");
+
   return kpgtbl;
 }
 
+// Counts the kernel stacks kvmstack() has mapped. A hart may
+// have cached the invalid PTE that a new mapping replaced (and
+// traps don't flush), so each hart flushes its TLB when this
+// has changed since it last looked, before it switches to a
+// process's kernel stack; see kvmstacksync().
+static volatile uint64 kstackgen;
+
+// Allocate a kernel stack page and map it at va, which is
+// KSTACK() of a struct proc that has none yet. The caller
+// keeps two from running at once.
+// returns 0 on success, -1 if out of memory.
+int
+kvmstack(uint64 va)
+{
+  char *pa;
+
+  if((pa = kalloc()) == 0)
+    return -1;
+  if(mappages(kernel_pagetable, va, PGSIZE, (uint64)pa, PTE_R | PTE_W) != 0){
+    kfree(pa);
+    return -1;
+  }
+  __sync_synchronize();
+  kstackgen++;
+  return 0;
+}
+
+// Unmap and free the kernel stack page at va, which no hart
+// is using. Harts that still cache the old mapping flush it
+// before anything can run on a stack mapped there again.
+void
+kvmunstack(uint64 va)
+{
+  pte_t *pte;
+
+  if((pte = walk(kernel_pagetable, va, 0)) == 0 || (*pte & PTE_V) == 0)
+    panic("kvmunstack");
+  kfree((void*)PTE2PA(*pte));
+  *pte = 0;
+}
+
+// Make sure this hart sees every kernel stack mapped so far.
+// Interrupts must be off.
+void
+kvmstacksync(void)
+{
+  struct cpu *c = mycpu();
+  uint64 gen = kstackgen;
+
+  if(c->kstackgen != gen){
+    __sync_synchronize();
+    sfence_vma();
+    c->kstackgen = gen;
+  }
+}
+
 // Initialize the one kernel_pagetable
 void
 kvminit(void)
 {
   kernel_pagetable = kvmmake();
+
+  initlock(&asids.lock, "asid");
+  asids.next = 1;
+  asids.generation = 1;
 }
 
 // Switch h/w page table register to the kernel's page table,
@@ -74,12 +163,201 @@ kvminithart()
 
   // satp レジスタに値をセットして(この CPU の)ページングを有効化
   // satp: supervisor address translation and protection
-  w_satp(MAKE_SATP(kernel_pagetable));
+  if(cpuid() == 0){
+    // find out how many ASID bits the harts implement by
+    // writing all ones into the field and seeing what sticks.
+    w_satp(MAKE_SATP(kernel_pagetable, SATP_ASID_MASK));
+    asids.max = SATP_ASID(r_satp());
+  }
+  w_satp(MAKE_SATP(kernel_pagetable, 0));
 
   // flush stale entries from the TLB.
   sfence_vma();
 }
 
+// Return the satp value that runs p's user page table on this
+// hart. Gives p a fresh ASID if its old one is from an earlier
+// generation, and drops this hart's TLB entries that earlier
+// changes to p's mappings made stale (see uvmflush()).
+// Interrupts must be off.
+uint64
+uvmsatp(struct proc *p)
+{
+  struct cpu *c = mycpu();
+  uint64 mask = 1L << cpuid();
+
+  if(asids.max == 0)
+    return MAKE_SATP(p->pagetable, 0);
+
+  if(ASIDGEN(p->asid) != asids.generation){
+    acquire(&asids.lock);
+    if(asids.next > asids.max){
+      // out of ASIDs. start a new generation; every hart
+      // may hold entries for ASIDs that are about to be
+      // handed out again.
+      asids.generation++;
+      asids.next = 1;
+      for(int i = 0; i < NCPU; i++)
+        cpus[i].tlbflush = 1;
+    }
+    p->asid = (asids.generation << 16) | asids.next++;
+    p->tlbstale = 0;
+    release(&asids.lock);
+  }
+
+  if(c->tlbflush){
+    // clear first, so that a rollover racing with us
+    // leaves the flag set rather than being lost.
+    c->tlbflush = 0;
+    __sync_synchronize();
+    sfence_vma();
+  } else if(p->tlbstale & mask){
+    sfence_vma_asid(ASIDNUM(p->asid));
+  }
+  p->tlbstale &= ~mask;
+
+  return MAKE_SATP(p->pagetable, ASIDNUM(p->asid));
+}
+
+// Switch this hart to p's page table, as uvmsatp() describes.
+// With SHAREDPT the kernel runs on it too, from the moment the
+// scheduler picks p (and after exec).
+void
+uvmswitch(struct proc *p)
+{
+  push_off();
+  uint64 satp = uvmsatp(p);
+  if(asids.max == 0)
+    sfence_vma();
+  w_satp(satp);
+  if(asids.max == 0)
+    sfence_vma();
+  pop_off();
+}
+
+// Switch this hart back to the kernel's own page table.
+void
+kvmswitch(void)
+{
+  if(asids.max == 0)
+    sfence_vma();
+  w_satp(MAKE_SATP(kernel_pagetable, 0));
+  if(asids.max == 0)
+    sfence_vma();
+}
+
+#ifdef SHAREDPT
+// Map the kernel into a process's page table, so that traps
+// need not switch page tables. The kernel's top-level entries
+// are shared outright, except for two: the first gigabyte holds
+// user memory below MAXUVA and the devices above it, so only the
+// device entries one level down are shared; the last one holds
+// the trampoline and the process's trapframe, and nothing else
+// the kernel needs; kernel stacks are in the gigabyte below it.
+// returns 0 on success, -1 if out of memory.
+int
+kvmshare(pagetable_t pagetable)
+{
+  pagetable_t l1, kl1;
+
+  for(int i = 1; i < PX(2, TRAMPOLINE); i++)
+    pagetable[i] = kernel_pagetable[i];
+
+  if((pagetable[0] & PTE_V) == 0){
+    if((l1 = (pagetable_t)kalloc_zeroed()) == 0)
+      return -1;
+    pagetable[0] = PA2PTE(l1) | PTE_V;
+  }
+  l1 = (pagetable_t)PTE2PA(pagetable[0]);
+  kl1 = (pagetable_t)PTE2PA(kernel_pagetable[0]);
+  for(int i = PX(1, MAXUVA); i < 512; i++)
+    l1[i] = kl1[i];
+  return 0;
+}
+
+// Undo kvmshare(), so that freewalk() finds only the process's
+// own page-table pages. Copes with a kvmshare() that failed
+// part way.
+void
+kvmunshare(pagetable_t pagetable)
+{
+  pagetable_t l1;
+
+  for(int i = 1; i < PX(2, TRAMPOLINE); i++)
+    pagetable[i] = 0;
+
+  if(pagetable[0] & PTE_V){
+    l1 = (pagetable_t)PTE2PA(pagetable[0]);
+    for(int i = PX(1, MAXUVA); i < 512; i++)
+      l1[i] = 0;
+  }
+}
+
+// Does the kernel run on pagetable right now, so that user
+// memory can be reached through it directly? Returns the
+// process that owns it, or 0.
+static struct proc*
+uvmdirect(pagetable_t pagetable)
+{
+  struct proc *p = myproc();
+
+  if(p != 0 && p->pagetable == pagetable)
+    return p;
+  return 0;
+}
+
+// The start of the user stack's guard page, which lies below
+// p->sz but has no PTE_U. The hardware doesn't keep the kernel
+// out of such a page, so copies made directly must.
+static uint64
+uvmguard(struct proc *p)
+{
+  return p->ustack ? p->ustack - PGSIZE : 0;
+}
+
+// May the kernel copy len bytes at va directly, in p's memory?
+static int
+uvmdirectok(struct proc *p, uint64 va, uint64 len)
+{
+  uint64 g = uvmguard(p);
+
+  if(va > p->sz || len > p->sz - va)
+    return 0;
+  if(p->ustack && va < g + PGSIZE && va + len > g)
+    return 0;
+  return 1;
+}
+#endif
+
+// Mappings in a user page table were just removed or added
+// (harts may cache invalid entries too). Only the running
+// process's own page table can have live TLB entries under
+// its ASID: flush them on this hart, and have every other
+// hart flush them before it next runs the process.
+// Other page tables are either not yet in use (exec) or
+// about to be freed along with their ASID, which is not
+// handed out again before every hart has flushed.
+// Without ASIDs, other harts flush whenever they switch page
+// tables, but this one may be running on pagetable (always,
+// with SHAREDPT), so it flushes everything.
+void
+uvmflush(pagetable_t pagetable)
+{
+  struct proc *p = myproc();
+
+  if(p == 0 || p->pagetable != pagetable)
+    return;
+  if(asids.max == 0){
+    sfence_vma();
+    return;
+  }
+
+  push_off();
+  sfence_vma_asid(ASIDNUM(p->asid));
+  p->tlbstale = ~(1L << cpuid());
+  pop_off();
+}
+
 // RISC-V Sv39 での仮想アドレス(64bit)は以下のように解釈される
 // va: [EXT: 25bit][L2: 9bit][L1: 9bit][L0: 9bit][Offset: 12bit]
 //   仮想アドレスの上位25ビットは使用されない
@@ -138,9 +416,8 @@ walk(pagetable_t pagetable, uint64 va, int alloc)
       // alloc は、エントリがなかった場合に新たに確保するかを表す引数？
       // alloc が 0 だったり、kalloc に失敗した場合はエラー終了
       // まずページテーブル用のページを確保し、その物理アドレスを pagetable で保持
-      if(!alloc || (pagetable = (pde_t*)kalloc()) == 0)
+      if(!alloc || (pagetable = (pde_t*)kalloc_zeroed()) == 0)
         return 0;
-      memset(pagetable, 0, PGSIZE);
       // 確保したページテーブル用ページの物理アドレスを変換して PTE にする
       // PTE の valid フラグを立て、エントリに追加する
       // これで次のループのとき、ちゃんとメモリ確保された場所で処理が行われる
@@ -222,8 +499,10 @@ mappages(pagetable_t pagetable, uint64 va, uint64 size, uint64 pa, int perm)
 }
 
 // Remove npages of mappings starting from va. va must be
-// page-aligned. The mappings must exist.
-// Optionally free the physical memory.
+// page-aligned. Pages that were never mapped, such as the
+// part of a user stack not yet grown into, are skipped.
+// Optionally free the physical memory, or the swap slot of
+// a page that was swapped out.
 void
 uvmunmap(pagetable_t pagetable, uint64 va, uint64 npages, int do_free)
 {
@@ -236,18 +515,28 @@ uvmunmap(pagetable_t pagetable, uint64 va, uint64 npages, int do_free)
   for(a = va; a < va + npages*PGSIZE; a += PGSIZE){
     // 開放したい仮想アドレスに紐づいているページを探す
     if((pte = walk(pagetable, a, 0)) == 0)
-      panic("uvmunmap: walk");
+      continue;
+    if(*pte & PTE_SWAP){
+      if(do_free)
+        swapfree(PTE2SLOT(*pte));
+      *pte = 0;
+      continue;
+    }
     if((*pte & PTE_V) == 0)
-      panic("uvmunmap: not mapped");
+      continue;
     if(PTE_FLAGS(*pte) == PTE_V)
       panic("uvmunmap: not a leaf");
     if(do_free){
       uint64 pa = PTE2PA(*pte);
-      kfree((void*)pa);
+      if(*pte & PTE_S)
+        pcput(pa);
+      else
+        kfree((void*)pa);
     }
     // エントリを 0 クリアしマッピングから外す
     *pte = 0;
   }
+  uvmflush(pagetable);
 }
 
 // kalloc で1ページ割り当てるだけ
@@ -257,10 +546,9 @@ pagetable_t
 uvmcreate()
 {
   pagetable_t pagetable;
-  pagetable = (pagetable_t) kalloc();
+  pagetable = (pagetable_t) kalloc_zeroed();
   if(pagetable == 0)
     return 0;
-  memset(pagetable, 0, PGSIZE);
   return pagetable;
 }
 
@@ -274,8 +562,7 @@ uvmfirst(pagetable_t pagetable, uchar *src, uint sz)
 
   if(sz >= PGSIZE)
     panic("uvmfirst: more than a page");
-  mem = kalloc();
-  memset(mem, 0, PGSIZE);
+  mem = kalloc_zeroed();
   mappages(pagetable, 0, PGSIZE, (uint64)mem, PTE_W|PTE_R|PTE_X|PTE_U);
   memmove(mem, src, sz);
 }
@@ -290,18 +577,19 @@ uvmalloc(pagetable_t pagetable, uint64 oldsz, uint64 newsz, int xperm)
 
   if(newsz < oldsz)
     return oldsz;
+  if(newsz > MAXUVA)
+    return 0;
 
   // 変更前の使用量を計算
   oldsz = PGROUNDUP(oldsz);
   // 足りない分をループで1ページずつ追加していく
   for(a = oldsz; a < newsz; a += PGSIZE){
     // 1ページ確保し mem にその物理アドレスを入れる
-    mem = kalloc();
+    mem = kalloc_zeroed();
     if(mem == 0){
       uvmdealloc(pagetable, a, oldsz);
       return 0;
     }
-    memset(mem, 0, PGSIZE);
     // 仮想アドレス上連続になるように、確保したページを map する
     if(mappages(pagetable, a, PGSIZE, (uint64)mem, PTE_R|PTE_U|xperm) != 0){
       kfree(mem);
@@ -309,6 +597,7 @@ uvmalloc(pagetable_t pagetable, uint64 oldsz, uint64 newsz, int xperm)
       return 0;
     }
   }
+  uvmflush(pagetable);
   return newsz;
 }
 
@@ -351,6 +640,26 @@ freewalk(pagetable_t pagetable)
   kfree((void*)pagetable);
 }
 
+// Count the pages of user memory below sz that are present,
+// and, in *shared, how many of them are shared with other
+// page tables.
+uint64
+uvmresident(pagetable_t pagetable, uint64 sz, uint64 *shared)
+{
+  pte_t *pte;
+  uint64 a, n = 0;
+
+  *shared = 0;
+  for(a = 0; a < sz; a += PGSIZE){
+    if((pte = walk(pagetable, a, 0)) == 0 || (*pte & PTE_V) == 0)
+      continue;
+    n++;
+    if(*pte & PTE_S)
+      (*shared)++;
+  }
+  return n;
+}
+
 // Free user memory pages,
 // then free page-table pages.
 void
@@ -364,39 +673,127 @@ uvmfree(pagetable_t pagetable, uint64 sz)
 // Given a parent process's page table, copy
 // its memory into a child's page table.
 // Copies both the page table and the
-// physical memory.
+// physical memory; a page that is swapped out
+// stays that way, its swap slot shared.
 // returns 0 on success, -1 on failure.
 // frees any allocated pages on failure.
 int
 uvmcopy(pagetable_t old, pagetable_t new, uint64 sz)
 {
-  pte_t *pte;
+  pte_t *pte, *npte, oldpte;
   uint64 pa, i;
   uint flags;
-  char *mem;
+  char *mem = 0;
 
   for(i = 0; i < sz; i += PGSIZE){
-    if((pte = walk(old, i, 0)) == 0)
-      panic("uvmcopy: pte should exist");
-    if((*pte & PTE_V) == 0)
-      panic("uvmcopy: page not present");
-    pa = PTE2PA(*pte);
-    flags = PTE_FLAGS(*pte);
-    if((mem = kalloc()) == 0)
+    // allocate before looking at old's PTE: kalloc() may swap
+    // out old's pages, when old is the caller's.
+    if(mem == 0 && (mem = kalloc()) == 0)
       goto err;
+    if((pte = walk(old, i, 0)) == 0 || (*pte & (PTE_V|PTE_SWAP)) == 0)
+      continue;  // stack not grown into yet
+    oldpte = *pte;
+    if(oldpte & PTE_SWAP){
+      if((npte = walk(new, i, 1)) == 0)
+        goto err;
+      *npte = oldpte;
+      swapdup(PTE2SLOT(oldpte));
+      continue;
+    }
+    pa = PTE2PA(oldpte);
+    flags = PTE_FLAGS(oldpte);
+    if(flags & PTE_S){
+      // share the page cache's read-only page.
+      if(mappages(new, i, PGSIZE, pa, flags) != 0)
+        goto err;
+      pcdup(pa);
+      continue;
+    }
     memmove(mem, (char*)pa, PGSIZE);
-    if(mappages(new, i, PGSIZE, (uint64)mem, flags) != 0){
-      kfree(mem);
+    if(mappages(new, i, PGSIZE, (uint64)mem, flags) != 0)
       goto err;
-    }
+    mem = 0;
   }
+  if(mem)
+    kfree(mem);
   return 0;
 
  err:
+  if(mem)
+    kfree(mem);
   uvmunmap(new, 0, i / PGSIZE, 1);
   return -1;
 }
 
+// The current process touched va, and it isn't there. If va
+// is a page that was swapped out, read it back in; if it lies
+// in the part of the user stack not used yet, give that page
+// memory. Returns 0 if the page is there now, -1 if va is a
+// bad address (or out of memory). exec() reserves MAXUSTACK
+// pages for the stack but maps only the top one; the rest are
+// mapped as the process touches them. Called from usertrap(),
+// or from copyin() and copyout() when a system call touches
+// the page first. Each counts as a page fault in p->acct.
+int
+uvmfault(pagetable_t pagetable, uint64 va)
+{
+  struct proc *p = myproc();
+  pte_t *pte;
+  char *mem;
+
+  if(p == 0 || p->pagetable != pagetable || va >= p->sz)
+    return -1;
+  va = PGROUNDDOWN(va);
+  pte = walk(pagetable, va, 0);
+  if(pte != 0 && (*pte & PTE_SWAP)){
+    if(swapin(pagetable, va) < 0)
+      return -1;
+  } else {
+    if(p->ustack == 0 || va < p->ustack || va >= p->ustack + MAXUSTACK*PGSIZE)
+      return -1;
+    if(pte != 0 && (*pte & PTE_V) != 0)
+      return -1;  // present, so some other kind of fault
+    if((mem = kalloc_zeroed()) == 0)
+      return -1;
+    if(mappages(pagetable, va, PGSIZE, (uint64)mem, PTE_R|PTE_W|PTE_U) != 0){
+      kfree(mem);
+      return -1;
+    }
+  }
+  uvmflush(pagetable);
+  p->acct.faults++;
+  return 0;
+}
+
+// Bring the current process's pages in [va, va+n) into memory,
+// and have swapout() leave them there until uvmunpin(). Pipes,
+// devices and wait() copy to and from user memory with a
+// spinlock held, so they can't wait for a page to be read back
+// in. Pages that can't be brought in are left for the copy to
+// fail on. One range at a time.
+void
+uvmpin(uint64 va, int n)
+{
+  struct proc *p = myproc();
+  uint64 a;
+
+  if(va >= p->sz || n <= 0)
+    return;
+  p->pinva = PGROUNDDOWN(va);
+  p->pinend = n > p->sz - va ? p->sz : va + n;
+  for(a = p->pinva; a < p->pinend; a += PGSIZE)
+    if(walkaddr(p->pagetable, a) == 0)
+      uvmfault(p->pagetable, a);
+}
+
+void
+uvmunpin(void)
+{
+  struct proc *p = myproc();
+
+  p->pinva = p->pinend = 0;
+}
+
 // mark a PTE invalid for user access.
 // used by exec for the user stack guard page.
 void
@@ -419,15 +816,32 @@ int
 copyout(pagetable_t pagetable, uint64 dstva, char *src, uint64 len)
 {
   uint64 n, va0, pa0;
+  pte_t *pte;
+
+#ifdef SHAREDPT
+  struct proc *p;
+  if((p = uvmdirect(pagetable)) != 0){
+    if(!uvmdirectok(p, dstva, len))
+      return -1;
+    return ucopy((void*)dstva, src, len);
+  }
+#endif
 
   while(len > 0){
     // 宛先のユーザ空間での仮想アドレスが含まれるページの先頭アドレスを計算
     // (仮想アドレスなので物理アドレスに変換しないといけない)
     va0 = PGROUNDDOWN(dstva);
+    if(va0 >= MAXVA)
+      return -1;
     // 対応するメモリページを見つけ物理アドレスを取得する
-    pa0 = walkaddr(pagetable, va0);
-    if(pa0 == 0)
+    // 書き込めないページ(共有しているプログラムのテキストなど)は除く
+    pte = walk(pagetable, va0, 0);
+    if((pte == 0 || (*pte & PTE_V) == 0) && uvmfault(pagetable, va0) == 0)
+      pte = walk(pagetable, va0, 0);
+    if(pte == 0 || (*pte & PTE_V) == 0 || (*pte & PTE_U) == 0 ||
+       (*pte & PTE_W) == 0)
       return -1;
+    pa0 = PTE2PA(*pte);
     // dstva - va0 は、コピー先の仮想アドレス(dstva)のオフセット
     // ページをまたいでコピーできないので dstva からページ末尾までのサイズを計算
     n = PGSIZE - (dstva - va0);
@@ -458,9 +872,20 @@ copyin(pagetable_t pagetable, char *dst, uint64 srcva, uint64 len)
 {
   uint64 n, va0, pa0;
 
+#ifdef SHAREDPT
+  struct proc *p;
+  if((p = uvmdirect(pagetable)) != 0){
+    if(!uvmdirectok(p, srcva, len))
+      return -1;
+    return ucopy(dst, (void*)srcva, len);
+  }
+#endif
+
   while(len > 0){
     va0 = PGROUNDDOWN(srcva);
     pa0 = walkaddr(pagetable, va0);
+    if(pa0 == 0 && uvmfault(pagetable, va0) == 0)
+      pa0 = walkaddr(pagetable, va0);
     if(pa0 == 0)
       return -1;
     n = PGSIZE - (srcva - va0);
@@ -492,12 +917,28 @@ copyinstr(pagetable_t pagetable, char *dst, uint64 srcva, uint64 max)
   uint64 n, va0, pa0;
   int got_null = 0;
 
+#ifdef SHAREDPT
+  struct proc *p;
+  if((p = uvmdirect(pagetable)) != 0){
+    uint64 end = p->sz;
+    if(p->ustack && srcva < uvmguard(p))
+      end = uvmguard(p);  // the string mustn't run into the guard
+    if(srcva >= end || !uvmdirectok(p, srcva, 1))
+      return -1;
+    if(max > end - srcva)
+      max = end - srcva;
+    return ucopystr(dst, (char*)srcva, max);
+  }
+#endif
+
   while(got_null == 0 && max > 0){
     // ページテーブルを walkaddr するためにユーザ空間の仮想アドレス va0 を
     // まず仮想アドレスが含まれるページ境界のアドレスに丸める
     va0 = PGROUNDDOWN(srcva);
     // walkaddr で物理アドレスに変換
     pa0 = walkaddr(pagetable, va0);
+    if(pa0 == 0 && uvmfault(pagetable, va0) == 0)
+      pa0 = walkaddr(pagetable, va0);
     if(pa0 == 0)
       return -1;
     n = PGSIZE - (srcva - va0);
@@ -0,0 +1,77 @@
+#!/usr/bin/perl -w
+
+# Boot xv6 under qemu, run the bench program in it, print its
+# results, and shut qemu down. make bench runs this as
+#
+#   perl tools/bench.pl qemu-system-riscv64 <qemu options>
+#
+# and make scalebench with -c scalebench, to run that command
+# instead of bench. The command must end its output with a
+# "bench: done" line.
+#
+# Only the "bench: " lines of the console output are printed,
+# one per result, so that two runs can be compared with diff
+# or a spreadsheet; the first is the boot time that init
+# reports. The full console output goes to bench.log.
+
+use strict;
+use IPC::Open2;
+
+my $timeout = 1200;   # seconds, for the whole run
+
+my $cmd = "bench";
+if (@ARGV >= 2 && $ARGV[0] eq "-c") {
+    shift;
+    $cmd = shift;
+}
+die "usage: bench.pl [-c command] qemu [options...]\n" unless @ARGV;
+
+open(my $log, ">", "bench.log") or die "bench.log: $!\n";
+my $pid = open2(my $out, my $in, @ARGV);
+$in->autoflush(1);
+
+$SIG{ALRM} = sub {
+    kill("TERM", $pid);
+    die "bench: timed out after $timeout seconds\n";
+};
+alarm($timeout);
+
+# wait for the shell's first prompt before typing at it.
+my $seen = "";
+my $c;
+while (sysread($out, $c, 1) == 1) {
+    print $log $c;
+    $seen .= $c;
+    last if $seen =~ /\$ $/;
+}
+die "bench: qemu exited before the shell started\n" unless $seen =~ /\$ $/;
+# init reports how long the boot took; count it as one result.
+if ($seen =~ /init: up (\d+) us after reset/) {
+    print "bench: boot 1 ops $1 us ", $1 * 1000, " ns/ops\n";
+}
+print $in "$cmd\n";
+
+my $done = 0;
+my $line = "";
+while (sysread($out, $c, 1) == 1) {
+    print $log $c;
+    if ($c ne "\n") {
+        $line .= $c;
+        next;
+    }
+    $line =~ s/\r$//;
+    if ($line =~ /^bench: /) {
+        print "$line\n";
+        if ($line eq "bench: done") {
+            $done = 1;
+            last;
+        }
+    }
+    $line = "";
+}
+
+alarm(0);
+kill("TERM", $pid);
+waitpid($pid, 0);
+close($log);
+exit($done ? 0 : 1);
@@ -0,0 +1,65 @@
+#!/usr/bin/perl -w
+
+# Turn the output of xv6's prof command into a flat profile
+# by function. Run from the top of the source tree, after
+# make, on a copy of the console output:
+#
+#   perl tools/profsym.pl console.log
+#
+# Kernel pcs are looked up in kernel/kernel.sym, and a user
+# program's pcs in user/<program>.sym.
+
+use strict;
+
+my %syms;    # file => [[addr, name], ...] sorted by addr
+my %count;   # "file:function" => samples
+my $total = 0;
+
+sub loadsyms {
+    my ($file) = @_;
+    my @s;
+
+    if (open(my $f, "<", $file)) {
+        while (<$f>) {
+            my ($addr, $name) = split;
+            next unless defined $name;
+            # skip sections, source file names and local labels.
+            next if $name =~ /^\./ || $name =~ /\.[cS]$/;
+            push @s, [hex($addr), $name];
+        }
+        close($f);
+    }
+    @s = sort { $a->[0] <=> $b->[0] } @s;
+    return \@s;
+}
+
+# the name of the last symbol at or below pc.
+sub lookup {
+    my ($s, $pc) = @_;
+    my ($lo, $hi) = (0, scalar(@$s));
+
+    while ($lo < $hi) {
+        my $mid = int(($lo + $hi) / 2);
+        if ($s->[$mid][0] <= $pc) {
+            $lo = $mid + 1;
+        } else {
+            $hi = $mid;
+        }
+    }
+    return $lo > 0 ? $s->[$lo-1][1] : sprintf("0x%x", $pc);
+}
+
+while (<>) {
+    next unless /prof: (\d+) (\S+) 0x([0-9a-fA-F]+)/;
+    my ($n, $prog, $pc) = ($1, $2, hex($3));
+    my $file = $prog eq "kernel" ? "kernel/kernel.sym" : "user/$prog.sym";
+
+    $syms{$file} = loadsyms($file) unless exists $syms{$file};
+    $count{"$prog:" . lookup($syms{$file}, $pc)} += $n;
+    $total += $n;
+}
+
+die "no prof: lines in input\n" if $total == 0;
+foreach my $fn (sort { $count{$b} <=> $count{$a} || $a cmp $b } keys %count) {
+    printf("%6d %5.1f%%  %s\n", $count{$fn}, 100 * $count{$fn} / $total, $fn);
+}
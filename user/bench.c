@@ -0,0 +1,820 @@
+//
+// Kernel performance microbenchmarks. bench without arguments
+// runs them all and bench <name> runs just <name>. Each
+// benchmark repeats an operation a fixed number of times and
+// reports one line per result,
+//
+//   bench: <name> <count> <unit> <usecs> us <nsecs> ns/<unit>
+//
+// where unit is ops or KB, and ends with "bench: done". make
+// bench boots the kernel and runs them all, for comparing one
+// kernel against another. Build with make SHAREDPT=1 to
+// compare against a kernel that shares each process's page
+// table.
+//
+
+#include "kernel/types.h"
+#include "kernel/stat.h"
+#include "user/user.h"
+#include "kernel/riscv.h"
+#include "kernel/fcntl.h"
+#include "kernel/ring.h"
+#include "kernel/poll.h"
+
+char buf[4096];
+
+// report n units of work done since t0, from uptimens().
+void
+report(char *s, int n, char *unit, uint64 t0)
+{
+  uint64 t = uptimens() - t0;
+
+  printf("bench: %s %d %s %l us %l ns/%s\n", s, n, unit, t/1000,
+         n > 0 ? t/n : 0, unit);
+}
+
+// a system call that does as little as possible.
+void
+nullsyscall(char *s)
+{
+  enum { N = 100000 };
+  uint64 t0 = uptimens();
+
+  for(int i = 0; i < N; i++)
+    sys_getpid();
+  report(s, N, "ops", t0);
+}
+
+// read the clock from the vdso page, which takes no system
+// call, and then through the system call it replaces.
+void
+clock(char *s)
+{
+  enum { N = 100000 };
+  uint64 t0 = uptimens();
+
+  for(int i = 0; i < N; i++)
+    uptimens();
+  report("clock-vdso", N, "ops", t0);
+
+  t0 = uptimens();
+  for(int i = 0; i < N; i++)
+    sys_uptime();
+  report("clock-syscall", N, "ops", t0);
+}
+
+// two processes bounce a byte back and forth through a pair
+// of pipes, so each round trip costs two context switches.
+void
+ctxsw(char *s)
+{
+  enum { N = 10000 };
+  int p1[2], p2[2], pid;
+  uint64 t0;
+  char c = 0;
+
+  if(pipe(p1) < 0 || pipe(p2) < 0){
+    printf("%s: pipe failed\n", s);
+    exit(1);
+  }
+  pid = fork();
+  if(pid < 0){
+    printf("%s: fork failed\n", s);
+    exit(1);
+  }
+  if(pid == 0){
+    for(int i = 0; i < N; i++){
+      if(read(p1[0], &c, 1) != 1 || write(p2[1], &c, 1) != 1)
+        exit(1);
+    }
+    exit(0);
+  }
+  t0 = uptimens();
+  for(int i = 0; i < N; i++){
+    if(write(p1[1], &c, 1) != 1 || read(p2[0], &c, 1) != 1){
+      printf("%s: ping-pong failed\n", s);
+      exit(1);
+    }
+  }
+  report(s, N, "ops", t0);
+  wait(0);
+  close(p1[0]);
+  close(p1[1]);
+  close(p2[0]);
+  close(p2[1]);
+}
+
+// stream data from a child through a pipe, a page at a time.
+void
+pipebw(char *s)
+{
+  enum { N = 4*1024*1024 };
+  int fds[2], pid, n, total;
+  uint64 t0;
+
+  if(pipe(fds) < 0){
+    printf("%s: pipe failed\n", s);
+    exit(1);
+  }
+  pid = fork();
+  if(pid < 0){
+    printf("%s: fork failed\n", s);
+    exit(1);
+  }
+  if(pid == 0){
+    close(fds[0]);
+    for(total = 0; total < N; total += sizeof(buf))
+      if(write(fds[1], buf, sizeof(buf)) != sizeof(buf))
+        exit(1);
+    exit(0);
+  }
+  close(fds[1]);
+  t0 = uptimens();
+  for(total = 0; (n = read(fds[0], buf, sizeof(buf))) > 0; total += n)
+    ;
+  report(s, total/1024, "KB", t0);
+  close(fds[0]);
+  wait(0);
+  if(total != N){
+    printf("%s: short read\n", s);
+    exit(1);
+  }
+}
+
+// fork and wait for children one at a time while NPARKED
+// other children sit blocked on a pipe, then kill the parked
+// children by pid and wait for them. none of it should slow
+// down with the number of processes.
+void
+forkwait(char *s)
+{
+  enum { NPARKED = 1000, N = 1000 };
+  static int pids[NPARKED];
+  int fds[2], pid, n, i;
+  uint64 t0;
+  char c;
+
+  if(pipe(fds) < 0){
+    printf("%s: pipe failed\n", s);
+    exit(1);
+  }
+  t0 = uptimens();
+  for(n = 0; n < NPARKED; n++){
+    if((pid = fork()) < 0)
+      break;
+    if(pid == 0){
+      read(fds[0], &c, 1);
+      exit(0);
+    }
+    pids[n] = pid;
+  }
+  report("fork-parked", n, "ops", t0);
+
+  t0 = uptimens();
+  for(i = 0; i < N; i++){
+    if((pid = fork()) < 0){
+      printf("%s: fork failed\n", s);
+      break;
+    }
+    if(pid == 0)
+      exit(0);
+    if(wait(0) != pid){
+      printf("%s: wait failed\n", s);
+      break;
+    }
+  }
+  report("fork-wait", i, "ops", t0);
+
+  t0 = uptimens();
+  for(i = 0; i < n; i++)
+    kill(pids[i]);
+  for(i = 0; i < n; i++)
+    wait(0);
+  report("kill-wait", n, "ops", t0);
+  close(fds[0]);
+  close(fds[1]);
+}
+
+// start a program that exits at once, with fork() and exec()
+// and then with spawn(), from a process with a 1 MB heap
+// that fork() must copy.
+void
+spawnrate(char *s)
+{
+  enum { N = 200, HEAP = 1024*1024 };
+  char *argv[] = { "bench", "-x", 0 };
+  char *heap;
+  int pid, i;
+  uint64 t0;
+
+  if((heap = sbrk(HEAP)) == (char*)-1){
+    printf("%s: sbrk failed\n", s);
+    exit(1);
+  }
+  memset(heap, 1, HEAP);
+
+  t0 = uptimens();
+  for(i = 0; i < N; i++){
+    if((pid = fork()) < 0){
+      printf("%s: fork failed\n", s);
+      exit(1);
+    }
+    if(pid == 0){
+      exec(argv[0], argv);
+      exit(1);
+    }
+    wait(0);
+  }
+  report("fork-exec", N, "ops", t0);
+
+  t0 = uptimens();
+  for(i = 0; i < N; i++){
+    if(spawn(argv[0], argv, 0, 0) < 0){
+      printf("%s: spawn failed\n", s);
+      exit(1);
+    }
+    wait(0);
+  }
+  report("spawn", N, "ops", t0);
+  sbrk(-HEAP);
+}
+
+// grow the heap, touch each new page, and give it back.
+// sbrk() allocates eagerly, so this is the cost per page of
+// allocating, zeroing, mapping and freeing user memory.
+void
+sbrkpages(char *s)
+{
+  enum { NPAGE = 64, N = 100 };
+  char *p;
+  uint64 t0;
+
+  t0 = uptimens();
+  for(int i = 0; i < N; i++){
+    if((p = sbrk(NPAGE*PGSIZE)) == (char*)-1){
+      printf("%s: sbrk failed\n", s);
+      exit(1);
+    }
+    for(int j = 0; j < NPAGE; j++)
+      p[j*PGSIZE] = 1;
+    sbrk(-NPAGE*PGSIZE);
+  }
+  report(s, N*NPAGE, "ops", t0);
+}
+
+// touch many pages, with a system call after each pass. a
+// trap that flushes the TLB makes every pass refill it.
+void
+tlb(char *s)
+{
+  enum { NPAGE = 64, N = 2000 };
+  char *p;
+  uint64 t0;
+
+  p = sbrk(NPAGE*PGSIZE);
+  if(p == (char*)-1){
+    printf("%s: sbrk failed\n", s);
+    exit(1);
+  }
+  t0 = uptimens();
+  for(int i = 0; i < N; i++){
+    for(int j = 0; j < NPAGE; j++)
+      p[j*PGSIZE]++;
+    sys_getpid();
+  }
+  report(s, N, "ops", t0);
+  sbrk(-NPAGE*PGSIZE);
+}
+
+// write a small file over and over. each write copies a
+// buffer in from user space and commits a transaction.
+void
+writefile(char *s)
+{
+  enum { N = 200, SZ = 16*1024 };
+  int fd;
+  uint64 t0;
+
+  t0 = uptimens();
+  for(int i = 0; i < N; i++){
+    if((fd = open("bench.tmp", O_CREATE|O_WRONLY)) < 0){
+      printf("%s: open failed\n", s);
+      exit(1);
+    }
+    for(int n = 0; n < SZ; n += sizeof(buf)){
+      if(write(fd, buf, sizeof(buf)) != sizeof(buf)){
+        printf("%s: write failed\n", s);
+        exit(1);
+      }
+    }
+    close(fd);
+  }
+  report(s, N*(SZ/1024), "KB", t0);
+}
+
+// read a small file over and over. it stays in the page
+// cache, so this mostly measures copying out to user space.
+void
+readfile(char *s)
+{
+  enum { N = 2000, SZ = 16*1024 };
+  int fd;
+  uint64 t0;
+
+  if((fd = open("bench.tmp", O_CREATE|O_WRONLY)) < 0){
+    printf("%s: open failed\n", s);
+    exit(1);
+  }
+  for(int n = 0; n < SZ; n += sizeof(buf))
+    write(fd, buf, sizeof(buf));
+  close(fd);
+
+  t0 = uptimens();
+  for(int i = 0; i < N; i++){
+    if((fd = open("bench.tmp", O_RDONLY)) < 0){
+      printf("%s: open failed\n", s);
+      exit(1);
+    }
+    for(int n = 0; n < SZ; n += sizeof(buf)){
+      if(read(fd, buf, sizeof(buf)) != sizeof(buf)){
+        printf("%s: read failed\n", s);
+        exit(1);
+      }
+    }
+    close(fd);
+  }
+  report(s, N*(SZ/1024), "KB", t0);
+  unlink("bench.tmp");
+}
+
+// read a 200 KB file over and over, much more than the
+// buffer cache holds but not the page cache.
+void
+readbig(char *s)
+{
+  enum { N = 20, SZ = 200*1024 };
+  int fd;
+  uint64 t0;
+
+  if((fd = open("bench.tmp", O_CREATE|O_WRONLY)) < 0){
+    printf("%s: open failed\n", s);
+    exit(1);
+  }
+  for(int n = 0; n < SZ; n += sizeof(buf)){
+    if(write(fd, buf, sizeof(buf)) != sizeof(buf)){
+      printf("%s: write failed\n", s);
+      exit(1);
+    }
+  }
+  close(fd);
+
+  t0 = uptimens();
+  for(int i = 0; i < N; i++){
+    if((fd = open("bench.tmp", O_RDONLY)) < 0){
+      printf("%s: open failed\n", s);
+      exit(1);
+    }
+    for(int n = 0; n < SZ; n += sizeof(buf)){
+      if(read(fd, buf, sizeof(buf)) != sizeof(buf)){
+        printf("%s: read failed\n", s);
+        exit(1);
+      }
+    }
+    close(fd);
+  }
+  report(s, N*(SZ/1024), "KB", t0);
+  unlink("bench.tmp");
+}
+
+// create and then delete many empty files in one directory.
+void
+createdel(char *s)
+{
+  enum { N = 200 };
+  char name[8];
+  int fd;
+  uint64 t0;
+
+  name[0] = 'b';
+  name[4] = 0;
+  t0 = uptimens();
+  for(int i = 0; i < N; i++){
+    name[1] = '0' + i/100;
+    name[2] = '0' + (i/10)%10;
+    name[3] = '0' + i%10;
+    if((fd = open(name, O_CREATE|O_WRONLY)) < 0){
+      printf("%s: create failed\n", s);
+      exit(1);
+    }
+    close(fd);
+  }
+  report("create", N, "ops", t0);
+
+  t0 = uptimens();
+  for(int i = 0; i < N; i++){
+    name[1] = '0' + i/100;
+    name[2] = '0' + (i/10)%10;
+    name[3] = '0' + i%10;
+    if(unlink(name) < 0){
+      printf("%s: unlink failed\n", s);
+      exit(1);
+    }
+  }
+  report("unlink", N, "ops", t0);
+}
+
+static uint randstate = 1;
+
+static uint
+rand(void)
+{
+  randstate = randstate * 1103515245 + 12345;
+  return randstate >> 16;
+}
+
+// write a new 200 KB file front to back, then write and read
+// it a block at a time in random order.
+void
+fileio(char *s)
+{
+  enum { SZ = 200*1024, BLK = 1024, N = 1000 };
+  int fd;
+  uint64 t0;
+
+  unlink("bench.tmp");
+  if((fd = open("bench.tmp", O_CREATE|O_RDWR)) < 0){
+    printf("%s: open failed\n", s);
+    exit(1);
+  }
+  t0 = uptimens();
+  for(int n = 0; n < SZ; n += sizeof(buf)){
+    if(write(fd, buf, sizeof(buf)) != sizeof(buf)){
+      printf("%s: write failed\n", s);
+      exit(1);
+    }
+  }
+  report("seq-write", SZ/1024, "KB", t0);
+
+  t0 = uptimens();
+  for(int i = 0; i < N; i++){
+    if(pwrite(fd, buf, BLK, (rand() % (SZ/BLK)) * BLK) != BLK){
+      printf("%s: pwrite failed\n", s);
+      exit(1);
+    }
+  }
+  report("rand-write", N*(BLK/1024), "KB", t0);
+
+  t0 = uptimens();
+  for(int i = 0; i < N; i++){
+    if(pread(fd, buf, BLK, (rand() % (SZ/BLK)) * BLK) != BLK){
+      printf("%s: pread failed\n", s);
+      exit(1);
+    }
+  }
+  report("rand-read", N*(BLK/1024), "KB", t0);
+  close(fd);
+  unlink("bench.tmp");
+}
+
+// grow the heap past the 128 MB of RAM that make qemu gives
+// the machine, so that the kernel has to swap, then write every
+// page front to back, check them all the same way, and touch
+// pages at random. front to back is CLOCK's worst case: each
+// page is swapped out shortly before the sweep gets back to it.
+void
+swapping(char *s)
+{
+  enum { SZ = 144*1024*1024, NPAGE = SZ/PGSIZE, N = 4000 };
+  char *p;
+  uint64 t0;
+
+  t0 = uptimens();
+  if((p = sbrk(SZ)) == (char*)-1){
+    printf("%s: sbrk failed\n", s);
+    exit(1);
+  }
+  report("swap-alloc", NPAGE, "ops", t0);
+
+  t0 = uptimens();
+  for(int i = 0; i < NPAGE; i++)
+    p[i*PGSIZE] = i;
+  report("swap-write", NPAGE, "ops", t0);
+
+  t0 = uptimens();
+  for(int i = 0; i < NPAGE; i++){
+    if(p[i*PGSIZE] != (char)i){
+      printf("%s: page %d lost its contents\n", s, i);
+      exit(1);
+    }
+  }
+  report("swap-read", NPAGE, "ops", t0);
+
+  t0 = uptimens();
+  for(int i = 0; i < N; i++)
+    p[(rand() % NPAGE)*PGSIZE]++;
+  report("swap-rand", N, "ops", t0);
+
+  sbrk(-SZ);
+}
+
+// commit small writes one at a time, first alone and then
+// while another process execs programs as fast as it can.
+// exec() reads the file system without a transaction, so it
+// shouldn't hold the writes' commits up.
+void
+execwrite(char *s)
+{
+  enum { N = 200 };
+  char *argv[] = { "bench", "-x", 0 };
+  int fd, pid;
+  uint64 t0;
+
+  for(int busy = 0; busy < 2; busy++){
+    pid = 0;
+    if(busy){
+      if((pid = fork()) < 0){
+        printf("%s: fork failed\n", s);
+        exit(1);
+      }
+      if(pid == 0){
+        for(;;){
+          if(spawn(argv[0], argv, 0, 0) < 0)
+            exit(1);
+          wait(0);
+        }
+      }
+    }
+    unlink("bench.tmp");
+    if((fd = open("bench.tmp", O_CREATE|O_WRONLY)) < 0){
+      printf("%s: open failed\n", s);
+      exit(1);
+    }
+    t0 = uptimens();
+    for(int i = 0; i < N; i++){
+      if(write(fd, buf, 16) != 16){
+        printf("%s: write failed\n", s);
+        exit(1);
+      }
+    }
+    report(busy ? "write-exec" : "write-idle", N, "ops", t0);
+    close(fd);
+    if(pid){
+      kill(pid);
+      wait(0);
+    }
+  }
+  unlink("bench.tmp");
+}
+
+// append small records, each a header and a payload, to a
+// log file: first with a write() for each part, each its own
+// transaction, and then with one writev() per record.
+void
+logrecords(char *s)
+{
+  enum { N = 500 };
+  struct { int seq, len; } hdr;
+  char payload[56];
+  struct iovec iov[2];
+  int fd;
+  uint64 t0;
+
+  memset(payload, 'x', sizeof(payload));
+  for(int vec = 0; vec < 2; vec++){
+    unlink("bench.tmp");
+    if((fd = open("bench.tmp", O_CREATE|O_WRONLY)) < 0){
+      printf("%s: open failed\n", s);
+      exit(1);
+    }
+    t0 = uptimens();
+    for(int i = 0; i < N; i++){
+      hdr.seq = i;
+      hdr.len = sizeof(payload);
+      if(vec){
+        iov[0].iov_base = &hdr;
+        iov[0].iov_len = sizeof(hdr);
+        iov[1].iov_base = payload;
+        iov[1].iov_len = sizeof(payload);
+        if(writev(fd, iov, 2) != sizeof(hdr) + sizeof(payload)){
+          printf("%s: writev failed\n", s);
+          exit(1);
+        }
+      } else if(write(fd, &hdr, sizeof(hdr)) != sizeof(hdr) ||
+                write(fd, payload, sizeof(payload)) != sizeof(payload)){
+        printf("%s: write failed\n", s);
+        exit(1);
+      }
+    }
+    report(vec ? "log-writev" : "log-write", N, "ops", t0);
+    close(fd);
+  }
+  unlink("bench.tmp");
+}
+
+// drain NPIPE pipes, each fed by its own writer process:
+// first from one process with a poll() loop, and then with a
+// reader process per pipe.
+void
+pollserve(char *s)
+{
+  enum { NPIPE = 32, N = 200, MSG = 16 };
+  struct pollfd pfd[NPIPE];
+  int fds[NPIPE], p[2], i, n, left;
+  uint64 t0;
+
+  for(int loop = 1; loop >= 0; loop--){
+    t0 = uptimens();
+    for(i = 0; i < NPIPE; i++){
+      if(pipe(p) < 0){
+        printf("%s: pipe failed\n", s);
+        exit(1);
+      }
+      if((n = fork()) < 0){
+        printf("%s: fork failed\n", s);
+        exit(1);
+      }
+      if(n == 0){
+        close(p[0]);
+        for(int j = 0; j < N; j++)
+          write(p[1], buf, MSG);
+        exit(0);
+      }
+      close(p[1]);
+      fds[i] = p[0];
+    }
+
+    if(loop){
+      for(i = 0; i < NPIPE; i++){
+        pfd[i].fd = fds[i];
+        pfd[i].events = POLLIN;
+      }
+      for(left = NPIPE; left > 0; ){
+        if(poll(pfd, NPIPE, -1) < 0){
+          printf("%s: poll failed\n", s);
+          exit(1);
+        }
+        for(i = 0; i < NPIPE; i++){
+          if(pfd[i].revents == 0)
+            continue;
+          if(read(pfd[i].fd, buf, sizeof(buf)) <= 0){
+            close(pfd[i].fd);
+            pfd[i].fd = -1;
+            left--;
+          }
+        }
+      }
+    } else {
+      for(i = 0; i < NPIPE; i++){
+        if((n = fork()) < 0){
+          printf("%s: fork failed\n", s);
+          exit(1);
+        }
+        if(n == 0){
+          while(read(fds[i], buf, sizeof(buf)) > 0)
+            ;
+          exit(0);
+        }
+      }
+      for(i = 0; i < NPIPE; i++)
+        close(fds[i]);
+    }
+    while(wait(0) > 0)
+      ;
+    report(loop ? "poll-loop" : "poll-fork", NPIPE*N, "ops", t0);
+  }
+}
+
+// read a cached file n bytes at a time, either with one
+// read() system call each or in batches through the ring.
+void
+ringpass(char *s, char *name, struct ring *r, int n, int passes)
+{
+  enum { SZ = 16*1024 };
+  int fd, i, k, ops = 0, calls = 0;
+  uint64 t0;
+
+  t0 = uptimens();
+  for(int pass = 0; pass < passes; pass++){
+    if((fd = open("bench.tmp", O_RDONLY)) < 0){
+      printf("%s: open failed\n", s);
+      exit(1);
+    }
+    for(i = 0; i < SZ; ){
+      if(r == 0){
+        if(read(fd, buf, n) != n){
+          printf("%s: read failed\n", s);
+          exit(1);
+        }
+        i += n;
+        ops++;
+        calls++;
+        continue;
+      }
+      for(k = 0; k < RING_NENT && i < SZ; k++, i += n){
+        struct ringsqe *e = &r->sq[r->sqtail % RING_NENT];
+        e->op = RING_READ;
+        e->fd = fd;
+        e->addr = (uint64)buf;
+        e->n = n;
+        e->data = i;
+        r->sqtail++;
+      }
+      if(ringenter() != k){
+        printf("%s: ringenter failed\n", s);
+        exit(1);
+      }
+      calls++;
+      for(; r->cqhead != r->cqtail; r->cqhead++, ops++){
+        if(r->cq[r->cqhead % RING_NENT].res != n){
+          printf("%s: ring read failed\n", s);
+          exit(1);
+        }
+      }
+    }
+    close(fd);
+  }
+  report(name, ops, "ops", t0);
+  printf("%s: %d syscalls\n", name, calls);
+}
+
+// compare reads through the submission ring with plain
+// read() system calls, for small and page-sized reads.
+void
+ringread(char *s)
+{
+  enum { SZ = 16*1024 };
+  struct ring *r;
+  int fd;
+
+  if((r = ringsetup()) == (struct ring*)-1){
+    printf("%s: ringsetup failed\n", s);
+    exit(1);
+  }
+  if((fd = open("bench.tmp", O_CREATE|O_WRONLY)) < 0){
+    printf("%s: open failed\n", s);
+    exit(1);
+  }
+  for(int n = 0; n < SZ; n += sizeof(buf))
+    write(fd, buf, sizeof(buf));
+  close(fd);
+
+  ringpass(s, "ring-read-1", 0, 1, 4);
+  ringpass(s, "ring-ring-1", r, 1, 4);
+  ringpass(s, "ring-read-4096", 0, 4096, 1000);
+  ringpass(s, "ring-ring-4096", r, 4096, 1000);
+  unlink("bench.tmp");
+}
+
+struct bench {
+  void (*f)(char *);
+  char *s;
+} benches[] = {
+  {nullsyscall, "syscall"},
+  {clock, "clock"},
+  {ctxsw, "ctxsw"},
+  {pipebw, "pipe"},
+  {forkwait, "fork"},
+  {spawnrate, "spawn"},
+  {sbrkpages, "sbrk"},
+  {tlb, "tlb"},
+  {writefile, "write"},
+  {readfile, "read"},
+  {readbig, "readbig"},
+  {createdel, "create"},
+  {fileio, "fileio"},
+  {execwrite, "execwrite"},
+  {swapping, "swap"},
+  {ringread, "ring"},
+  {logrecords, "log"},
+  {pollserve, "poll"},
+  { 0, 0},
+};
+
+int
+main(int argc, char *argv[])
+{
+  struct bench *b;
+  int i, ran = 0;
+
+  // the spawn benchmark's child.
+  if(argc == 2 && strcmp(argv[1], "-x") == 0)
+    exit(0);
+
+  for(b = benches; b->s != 0; b++){
+    if(argc > 1){
+      for(i = 1; i < argc; i++)
+        if(strcmp(argv[i], b->s) == 0)
+          break;
+      if(i == argc)
+        continue;
+    }
+    b->f(b->s);
+    ran++;
+  }
+  if(ran == 0){
+    printf("usage: bench [name...]\n");
+    exit(1);
+  }
+  printf("bench: done\n");
+  exit(0);
+}
@@ -23,6 +23,10 @@ main(void)
   dup(0);  // stdout
   dup(0);  // stderr
 
+  // the time CSR counts from reset, so this is how long the
+  // boot took.
+  printf("init: up %d us after reset\n", (int)(uptimens() / 1000));
+
   for(;;){
     printf("init: starting sh\n");
     pid = fork();
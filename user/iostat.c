@@ -0,0 +1,143 @@
+//
+// iostat [-h] [interval [count]]: show buffer cache, log and
+// disk statistics. With no interval, shows totals since boot,
+// with a histogram of disk request latencies if -h is given.
+// Otherwise prints a line of what happened in each interval
+// ticks, count times (forever if count is 0).
+//
+
+#include "kernel/types.h"
+#include "kernel/stat.h"
+#include "kernel/spinlock.h"
+#include "kernel/sleeplock.h"
+#include "kernel/fs.h"
+#include "kernel/file.h"
+#include "kernel/fcntl.h"
+#include "kernel/riscv.h"
+#include "kernel/memlayout.h"
+#include "kernel/iostat.h"
+#include "user/user.h"
+
+// print v right-aligned in a field w wide.
+void
+putnum(uint64 v, int w)
+{
+  char buf[24];
+  int i = sizeof(buf) - 1;
+
+  buf[i] = 0;
+  do {
+    buf[--i] = '0' + v % 10;
+    v /= 10;
+  } while(v != 0 && i > 0);
+  while(sizeof(buf) - 1 - i < w && i > 0)
+    buf[--i] = ' ';
+  printf("%s", buf + i);
+}
+
+uint64
+usec(uint64 t)
+{
+  return t * 1000000 / ((struct vdso*)VDSO)->timebase;
+}
+
+uint64
+div(uint64 x, uint64 y)
+{
+  return y ? x / y : 0;
+}
+
+void
+totals(struct iostats *st, int hflag)
+{
+  printf("buffer cache: %l hits, %l misses, %l%% hit, %l evictions\n",
+         st->bhits, st->bmisses,
+         div(st->bhits * 100, st->bhits + st->bmisses), st->bevicts);
+  printf("log: %l ops, %l commits, %l blocks/commit (max %l), "
+         "%l absorbed writes, %l us/commit (max %l)\n",
+         st->ops, st->commits, div(st->logblocks, st->commits),
+         st->maxcommit, st->absorbed,
+         usec(div(st->committime, st->commits)), usec(st->maxcommittime));
+  printf("disk: %l reads, %l writes, %l KB, %l in flight (max %l), %l us/request\n",
+         st->dreads, st->dwrites, st->dbytes / 1024, st->dinflight,
+         st->dmaxinflight, usec(div(st->dtime, st->dreads + st->dwrites)));
+  if(hflag){
+    for(int i = 0; i < NIOHIST; i++){
+      if(st->dhist[i] == 0)
+        continue;
+      printf("    >= ");
+      putnum(i == 0 ? 0 : usec(1L << i), 8);
+      printf(" us ");
+      putnum(st->dhist[i], 10);
+      printf("\n");
+    }
+  }
+}
+
+void
+line(struct iostats *a, struct iostats *b)
+{
+  uint64 hits = b->bhits - a->bhits, misses = b->bmisses - a->bmisses;
+  uint64 commits = b->commits - a->commits;
+  uint64 reqs = b->dreads + b->dwrites - a->dreads - a->dwrites;
+
+  putnum(hits, 7);
+  putnum(misses, 7);
+  putnum(div(hits * 100, hits + misses), 5);
+  putnum(b->bevicts - a->bevicts, 7);
+  putnum(b->ops - a->ops, 7);
+  putnum(commits, 7);
+  putnum(div(b->logblocks - a->logblocks, commits), 6);
+  putnum(b->absorbed - a->absorbed, 7);
+  putnum(b->dreads - a->dreads, 7);
+  putnum(b->dwrites - a->dwrites, 7);
+  putnum((b->dbytes - a->dbytes) / 1024, 7);
+  putnum(b->dinflight, 5);
+  putnum(usec(div(b->dtime - a->dtime, reqs)), 7);
+  printf("\n");
+}
+
+int
+main(int argc, char *argv[])
+{
+  struct iostats old, cur;
+  int fd, i, hflag = 0, interval = 0, count = 0;
+
+  i = 1;
+  if(i < argc && strcmp(argv[i], "-h") == 0){
+    hflag = 1;
+    i++;
+  }
+  if(i < argc && argv[i][0] == '-'){
+    fprintf(2, "usage: iostat [-h] [interval [count]]\n");
+    exit(1);
+  }
+  if(i < argc)
+    interval = atoi(argv[i++]);
+  if(i < argc)
+    count = atoi(argv[i++]);
+
+  if((fd = open("/iostats", O_RDONLY)) < 0){
+    mknod("/iostats", IOSTATS, 0);
+    fd = open("/iostats", O_RDONLY);
+  }
+  if(fd < 0 || read(fd, &cur, sizeof(cur)) != sizeof(cur)){
+    fprintf(2, "iostat: cannot read /iostats\n");
+    exit(1);
+  }
+  if(interval <= 0){
+    totals(&cur, hflag);
+    exit(0);
+  }
+
+  printf("   bhit  bmiss hit%%  evict    ops commit blk/c absorb"
+         "  reads writes     KB  inq us/req\n");
+  for(i = 0; count == 0 || i < count; i++){
+    old = cur;
+    sleep(interval);
+    if(read(fd, &cur, sizeof(cur)) != sizeof(cur))
+      break;
+    line(&old, &cur);
+  }
+  exit(0);
+}
@@ -0,0 +1,142 @@
+//
+// lockstat [-n count] [command [args...]]: list the most
+// contended locks, count of them (10 by default), with the
+// callers that held each longest. With a command, starts the
+// counts over, runs command, and lists the locks once it
+// exits; otherwise lists them as counted since boot. Needs a
+// kernel built with make LOCKSTAT=1.
+//
+
+#include "kernel/types.h"
+#include "kernel/stat.h"
+#include "kernel/spinlock.h"
+#include "kernel/sleeplock.h"
+#include "kernel/fs.h"
+#include "kernel/file.h"
+#include "kernel/fcntl.h"
+#include "kernel/riscv.h"
+#include "kernel/memlayout.h"
+#include "kernel/lockstat.h"
+#include "user/user.h"
+
+struct lockstat st[NLOCKSTAT];
+
+// print v right-aligned in a field w wide.
+void
+putnum(uint64 v, int w)
+{
+  char buf[24];
+  int i = sizeof(buf) - 1;
+
+  buf[i] = 0;
+  do {
+    buf[--i] = '0' + v % 10;
+    v /= 10;
+  } while(v != 0 && i > 0);
+  while(sizeof(buf) - 1 - i < w && i > 0)
+    buf[--i] = ' ';
+  printf("%s", buf + i);
+}
+
+// print s left-aligned in a field w wide.
+void
+putstr(char *s, int w)
+{
+  int n = strlen(s);
+
+  printf("%s", s);
+  for(; n < w; n++)
+    printf(" ");
+}
+
+uint64
+usec(uint64 t)
+{
+  return t * 1000000 / ((struct vdso*)VDSO)->timebase;
+}
+
+// print the holders of l, longest first.
+void
+holders(struct lockstat *l)
+{
+  int i, best;
+
+  for(;;){
+    best = -1;
+    for(i = 0; i < NLOCKPC; i++)
+      if(l->pchold[i] && (best < 0 || l->pchold[i] > l->pchold[best]))
+        best = i;
+    if(best < 0)
+      break;
+    printf("    held by %p for ", l->pc[best]);
+    putnum(usec(l->pchold[best]), 1);
+    printf(" us\n");
+    l->pchold[best] = 0;
+  }
+}
+
+int
+main(int argc, char *argv[])
+{
+  struct lockstat *l, *best;
+  int fd, i, n, count = 10;
+
+  i = 1;
+  if(i + 1 < argc && strcmp(argv[i], "-n") == 0){
+    count = atoi(argv[i + 1]);
+    i += 2;
+  }
+  if(i < argc && argv[i][0] == '-'){
+    fprintf(2, "usage: lockstat [-n count] [command [args...]]\n");
+    exit(1);
+  }
+
+  if((fd = open("/lockstat", O_RDWR)) < 0){
+    mknod("/lockstat", LOCKSTATDEV, 0);
+    fd = open("/lockstat", O_RDWR);
+  }
+  if(fd < 0){
+    fprintf(2, "lockstat: cannot open /lockstat\n");
+    exit(1);
+  }
+
+  if(i < argc){
+    write(fd, "0", 1);
+    if(spawn(argv[i], argv + i, 0, 0) < 0){
+      fprintf(2, "lockstat: cannot run %s\n", argv[i]);
+      exit(1);
+    }
+    wait(0);
+  }
+
+  if((n = read(fd, st, sizeof(st))) <= 0){
+    fprintf(2, "lockstat: no statistics; build the kernel with make LOCKSTAT=1\n");
+    exit(1);
+  }
+  n /= sizeof(st[0]);
+
+  printf("name             kind   acquires contended    wait us    hold us  max us\n");
+  for(; count > 0; count--){
+    best = 0;
+    for(l = st; l < st + n; l++){
+      if(l->acquires == 0)
+        continue;
+      if(best == 0 || l->contended > best->contended ||
+         (l->contended == best->contended && l->wait > best->wait))
+        best = l;
+    }
+    if(best == 0)
+      break;
+    putstr(best->name, 17);
+    putstr(best->sleep ? "sleep" : "spin", 5);
+    putnum(best->acquires, 11);
+    putnum(best->contended, 10);
+    putnum(usec(best->wait), 11);
+    putnum(usec(best->hold), 11);
+    putnum(usec(best->maxhold), 8);
+    printf("\n");
+    holders(best);
+    best->acquires = 0;
+  }
+  exit(0);
+}
@@ -0,0 +1,52 @@
+//
+// memstat: show how many physical pages are free, and how
+// often kalloc_zeroed() found a page that an idle hart had
+// zeroed ahead of time.
+//
+
+#include "kernel/types.h"
+#include "kernel/stat.h"
+#include "kernel/spinlock.h"
+#include "kernel/sleeplock.h"
+#include "kernel/fs.h"
+#include "kernel/file.h"
+#include "kernel/fcntl.h"
+#include "kernel/riscv.h"
+#include "kernel/memstat.h"
+#include "user/user.h"
+
+uint64
+div(uint64 x, uint64 y)
+{
+  return y ? x / y : 0;
+}
+
+int
+main(int argc, char *argv[])
+{
+  struct memstats st;
+  int fd;
+
+  if(argc != 1){
+    fprintf(2, "usage: memstat\n");
+    exit(1);
+  }
+
+  if((fd = open("/memstat", O_RDONLY)) < 0){
+    mknod("/memstat", MEMSTATS, 0);
+    fd = open("/memstat", O_RDONLY);
+  }
+  if(fd < 0 || read(fd, &st, sizeof(st)) != sizeof(st)){
+    fprintf(2, "memstat: cannot read /memstat\n");
+    exit(1);
+  }
+
+  printf("pages: %l free, %l never used, %l zeroed (%l KB free in all)\n",
+         st.free, st.fresh, st.zeroed,
+         (st.free + st.fresh + st.zeroed) * (PGSIZE / 1024));
+  printf("zeroed pages: %l hits, %l misses, %l%% hit, %l zeroed by idle harts, "
+         "%l taken by kalloc\n",
+         st.zhits, st.zmisses, div(st.zhits * 100, st.zhits + st.zmisses),
+         st.zfills, st.zsteals);
+  exit(0);
+}
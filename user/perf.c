@@ -0,0 +1,69 @@
+//
+// Timing regions of a program with the performance counters:
+//
+//   struct perfregion r = { "name" };
+//
+//   perfbegin(&r);
+//   ...
+//   perfend(&r);      // as many times as you like
+//   perfreport(&r);
+//
+// A region counts the elapsed time, and the cycles,
+// instructions and HPM events of this process alone. If the
+// program hasn't called perfopen(), perfbegin() does, with
+// no HPM events.
+//
+
+#include "kernel/types.h"
+#include "kernel/param.h"
+#include "kernel/riscv.h"
+#include "kernel/memlayout.h"
+#include "kernel/perf.h"
+#include "user/user.h"
+
+void
+perfbegin(struct perfregion *r)
+{
+  if(perfread(r->start, NPERFCTR) < 0){
+    perfopen(0, 0);
+    perfread(r->start, NPERFCTR);
+  }
+  r->t0 = r_time();
+}
+
+void
+perfend(struct perfregion *r)
+{
+  uint64 t = r_time(), v[NPERFCTR];
+
+  perfread(v, NPERFCTR);
+  for(int i = 0; i < NPERFCTR; i++)
+    r->total[i] += v[i] - r->start[i];
+  r->time += t - r->t0;
+  r->n++;
+}
+
+// print x/y with two decimal places.
+static void
+printratio(uint64 x, uint64 y)
+{
+  uint64 q = y ? x * 100 / y : 0;
+
+  printf("%l.%l%l", q / 100, q / 10 % 10, q % 10);
+}
+
+void
+perfreport(struct perfregion *r)
+{
+  uint64 n = r->n ? r->n : 1;
+  uint64 hz = ((struct vdso*)VDSO)->timebase;
+
+  printf("%s: %l runs, %l us/run, %l cycles/run, %l instructions/run, IPC ",
+         r->name, r->n, r->time * 1000000 / hz / n,
+         r->total[PERF_CYCLE] / n, r->total[PERF_INSTRET] / n);
+  printratio(r->total[PERF_INSTRET], r->total[PERF_CYCLE]);
+  for(int i = 0; i < NHPM; i++)
+    if(r->total[PERF_HPM+i])
+      printf(", hpm%d %l/run", 3+i, r->total[PERF_HPM+i] / n);
+  printf("\n");
+}
@@ -0,0 +1,138 @@
+//
+// prof command [args...]: run command under the sampling
+// profiler and print where every CPU spent its time while it
+// ran, one line per distinct pc, most frequent first:
+//
+//   prof: <samples> <kernel|program> <pc>
+//
+// The profile covers the whole machine, not just command.
+// Feed the console output to tools/profsym.pl on the host to
+// turn pcs into function names.
+//
+
+#include "kernel/types.h"
+#include "kernel/stat.h"
+#include "kernel/spinlock.h"
+#include "kernel/sleeplock.h"
+#include "kernel/fs.h"
+#include "kernel/file.h"
+#include "user/user.h"
+#include "kernel/fcntl.h"
+#include "kernel/poll.h"
+#include "kernel/prof.h"
+
+#define NHASH 4096  // distinct pcs kept; must be a power of two
+
+struct entry {
+  uint64 pc;
+  char name[16];  // "kernel", or the program pc is in
+  int n;
+};
+
+struct entry *tab;
+int ndistinct, nlost;
+struct profsample samples[64];
+
+void
+add(struct profsample *s)
+{
+  char *name = s->user ? s->name : "kernel";
+  uint h = (s->pc >> 1) * 2654435761u;
+  struct entry *e;
+
+  for(int i = 0; i < NHASH; i++){
+    e = &tab[(h + i) & (NHASH - 1)];
+    if(e->n == 0){
+      if(ndistinct == NHASH - 1)
+        break;
+      ndistinct++;
+      e->pc = s->pc;
+      strcpy(e->name, name);
+    }
+    if(e->pc == s->pc && strcmp(e->name, name) == 0){
+      e->n++;
+      return;
+    }
+  }
+  nlost++;
+}
+
+// read all the samples waiting in the profiler.
+void
+drain(int fd)
+{
+  int n;
+
+  while((n = read(fd, samples, sizeof(samples))) > 0)
+    for(int i = 0; i < n / sizeof(samples[0]); i++)
+      add(&samples[i]);
+}
+
+int
+main(int argc, char *argv[])
+{
+  int fd, pid, p[2], total;
+  struct pollfd pfd;
+  struct spawnfa fa;
+  struct entry *e, *best;
+
+  if(argc < 2){
+    fprintf(2, "usage: prof command [args...]\n");
+    exit(1);
+  }
+
+  if((fd = open("/prof", O_RDWR)) < 0){
+    mknod("/prof", PROF, 0);
+    fd = open("/prof", O_RDWR);
+  }
+  if(fd < 0 || (tab = malloc(NHASH * sizeof(*tab))) == 0){
+    fprintf(2, "prof: cannot open /prof\n");
+    exit(1);
+  }
+  memset(tab, 0, NHASH * sizeof(*tab));
+
+  // command holds the write end of p, so the read end sees
+  // end-of-file once command, and anything it starts, exits.
+  if(pipe(p) < 0){
+    fprintf(2, "prof: pipe failed\n");
+    exit(1);
+  }
+  fa.op = SPAWN_CLOSE;
+  fa.fd = p[0];
+  write(fd, "1", 1);
+  if((pid = spawn(argv[1], argv + 1, &fa, 1)) < 0){
+    write(fd, "0", 1);
+    fprintf(2, "prof: cannot run %s\n", argv[1]);
+    exit(1);
+  }
+  close(p[1]);
+
+  pfd.fd = p[0];
+  pfd.events = POLLIN;
+  for(;;){
+    drain(fd);
+    if(poll(&pfd, 1, 10) > 0 && read(p[0], samples, 1) <= 0)
+      break;
+  }
+  write(fd, "0", 1);
+  drain(fd);
+  wait(0);
+
+  total = 0;
+  for(e = tab; e < tab + NHASH; e++)
+    total += e->n;
+  printf("prof: %d samples\n", total + nlost);
+  for(;;){
+    best = 0;
+    for(e = tab; e < tab + NHASH; e++)
+      if(e->n > 0 && (best == 0 || e->n > best->n))
+        best = e;
+    if(best == 0)
+      break;
+    printf("prof: %d %s %p\n", best->n, best->name, best->pc);
+    best->n = 0;
+  }
+  if(nlost)
+    printf("prof: %d samples at other pcs\n", nlost);
+  exit(0);
+}
@@ -0,0 +1,83 @@
+//
+// ps: list processes, with the CPU time, memory and I/O
+// each has used.
+//
+
+#include "kernel/types.h"
+#include "kernel/stat.h"
+#include "kernel/param.h"
+#include "kernel/riscv.h"
+#include "kernel/memlayout.h"
+#include "kernel/procinfo.h"
+#include "user/user.h"
+
+char *states[] = {
+[PI_UNUSED]    "unused",
+[PI_USED]      "used",
+[PI_SLEEPING]  "sleep",
+[PI_RUNNABLE]  "runble",
+[PI_RUNNING]   "run",
+[PI_ZOMBIE]    "zombie",
+};
+
+// print v right-aligned in a field w wide.
+void
+putnum(uint64 v, int w)
+{
+  char buf[24];
+  int i = sizeof(buf) - 1;
+
+  buf[i] = 0;
+  do {
+    buf[--i] = '0' + v % 10;
+    v /= 10;
+  } while(v != 0 && i > 0);
+  while(sizeof(buf) - 1 - i < w && i > 0)
+    buf[--i] = ' ';
+  printf("%s", buf + i);
+}
+
+// print s left-aligned in a field w wide.
+void
+putstr(char *s, int w)
+{
+  printf("%s", s);
+  for(int n = strlen(s); n < w; n++)
+    printf(" ");
+}
+
+uint64
+msec(uint64 t)
+{
+  return t * 1000 / ((struct vdso*)VDSO)->timebase;
+}
+
+int
+main(int argc, char *argv[])
+{
+  struct procinfo *pi;
+  int i, n;
+
+  if((pi = malloc(NPROC * sizeof(*pi))) == 0 ||
+     (n = getprocinfo(pi, NPROC)) < 0){
+    fprintf(2, "ps: getprocinfo failed\n");
+    exit(1);
+  }
+  printf("  PID  PPID STATE   USR ms  SYS ms  SWITCH  FAULT   RSS SHARED     READ    WRITE NAME\n");
+  for(i = 0; i < n; i++){
+    putnum(pi[i].pid, 5);
+    putnum(pi[i].ppid, 6);
+    printf(" ");
+    putstr(pi[i].state >= 0 && pi[i].state <= PI_ZOMBIE ? states[pi[i].state] : "?", 6);
+    putnum(msec(pi[i].utime), 8);
+    putnum(msec(pi[i].stime), 8);
+    putnum(pi[i].nvcsw + pi[i].nivcsw, 8);
+    putnum(pi[i].faults, 7);
+    putnum(pi[i].rss, 6);
+    putnum(pi[i].shared, 7);
+    putnum(pi[i].rbytes, 9);
+    putnum(pi[i].wbytes, 9);
+    printf(" %s\n", pi[i].name);
+  }
+  exit(0);
+}
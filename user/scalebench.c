@@ -0,0 +1,233 @@
+//
+// Multi-core scalability benchmarks. scalebench runs each
+// workload in one process per hart at once, or in nproc
+// processes with -p nproc, and reports their combined
+// throughput, one line per workload:
+//
+//   bench: <name> <ncpu> harts <nproc> procs <ops> ops <usecs> us <rate> ops/s
+//
+// scalebench <name>... runs just the named workloads. make
+// scalebench boots the kernel with 1 through 8 harts and runs
+// scalebench on each. A workload whose rate doesn't grow with
+// the number of harts is serialized on a lock: kmem for alloc
+// and fork, bcache, itable and the log for create and open,
+// ftable for open and pipe.
+//
+
+#include "kernel/types.h"
+#include "kernel/stat.h"
+#include "user/user.h"
+#include "kernel/riscv.h"
+#include "kernel/memlayout.h"
+#include "kernel/fcntl.h"
+
+// a system call that takes no locks, for comparison.
+int
+nullsyscall(int id)
+{
+  enum { N = 20000 };
+
+  for(int i = 0; i < N; i++)
+    sys_getpid();
+  return N;
+}
+
+// grow the heap, touch the new pages, and give them back.
+int
+alloc(int id)
+{
+  enum { NPAGE = 16, N = 50 };
+  char *p;
+
+  for(int i = 0; i < N; i++){
+    if((p = sbrk(NPAGE*PGSIZE)) == (char*)-1)
+      return -1;
+    for(int j = 0; j < NPAGE; j++)
+      p[j*PGSIZE] = 1;
+    sbrk(-NPAGE*PGSIZE);
+  }
+  return N*NPAGE;
+}
+
+// fork a child that exits at once, and wait for it.
+int
+forkexit(int id)
+{
+  enum { N = 50 };
+  int pid;
+
+  for(int i = 0; i < N; i++){
+    if((pid = fork()) < 0)
+      return -1;
+    if(pid == 0)
+      exit(0);
+    wait(0);
+  }
+  return N;
+}
+
+// bounce a byte back and forth with a child of our own.
+int
+pingpong(int id)
+{
+  enum { N = 1000 };
+  int p1[2], p2[2], pid;
+  char c = 0;
+
+  if(pipe(p1) < 0 || pipe(p2) < 0)
+    return -1;
+  if((pid = fork()) < 0)
+    return -1;
+  if(pid == 0){
+    while(read(p1[0], &c, 1) == 1)
+      write(p2[1], &c, 1);
+    exit(0);
+  }
+  close(p1[0]);
+  close(p2[1]);
+  for(int i = 0; i < N; i++)
+    if(write(p1[1], &c, 1) != 1 || read(p2[0], &c, 1) != 1)
+      return -1;
+  close(p1[1]);
+  close(p2[0]);
+  wait(0);
+  return N;
+}
+
+// create and delete a file, each process in a directory of
+// its own, so that only the file system's own locks are
+// shared.
+int
+createdel(int id)
+{
+  enum { N = 50 };
+  char dir[4];
+  int fd;
+
+  dir[0] = 's';
+  dir[1] = '0' + id/10;
+  dir[2] = '0' + id%10;
+  dir[3] = 0;
+  if(mkdir(dir) < 0 || chdir(dir) < 0)
+    return -1;
+  for(int i = 0; i < N; i++){
+    if((fd = open("f", O_CREATE|O_WRONLY)) < 0)
+      return -1;
+    close(fd);
+    if(unlink("f") < 0)
+      return -1;
+  }
+  chdir("..");
+  if(unlink(dir) < 0)
+    return -1;
+  return N;
+}
+
+// open and close the same file as every other process.
+int
+openclose(int id)
+{
+  enum { N = 500 };
+  int fd;
+
+  for(int i = 0; i < N; i++){
+    if((fd = open("README", O_RDONLY)) < 0)
+      return -1;
+    close(fd);
+  }
+  return N;
+}
+
+struct work {
+  int (*f)(int);
+  char *s;
+} works[] = {
+  {nullsyscall, "syscall"},
+  {alloc, "alloc"},
+  {forkexit, "fork"},
+  {pingpong, "pipe"},
+  {createdel, "create"},
+  {openclose, "open"},
+  { 0, 0 },
+};
+
+// run w in nproc processes at once and report how long it
+// took them all. the processes wait on a pipe until all have
+// been forked, so that they start together, and each exits
+// with the number of operations it did, or -1.
+void
+run(struct work *w, int nproc)
+{
+  int gate[2], pid, xstatus, ok = 1;
+  uint64 ops = 0, t0, t;
+  char c;
+
+  if(pipe(gate) < 0){
+    printf("scalebench: pipe failed\n");
+    exit(1);
+  }
+  for(int i = 0; i < nproc; i++){
+    if((pid = fork()) < 0){
+      printf("scalebench: fork failed\n");
+      exit(1);
+    }
+    if(pid == 0){
+      close(gate[1]);
+      read(gate[0], &c, 1);
+      exit(w->f(i));
+    }
+  }
+  close(gate[0]);
+  t0 = uptimens();
+  close(gate[1]);
+  for(int i = 0; i < nproc; i++){
+    wait(&xstatus);
+    if(xstatus < 0)
+      ok = 0;
+    ops += xstatus;
+  }
+  t = uptimens() - t0;
+  if(!ok){
+    printf("scalebench: %s failed\n", w->s);
+    exit(1);
+  }
+
+  printf("bench: %s %d harts %d procs %l ops %l us %l ops/s\n",
+         w->s, (int)((struct vdso*)VDSO)->ncpu, nproc, ops, t/1000,
+         t > 0 ? ops*1000000000/t : 0);
+}
+
+int
+main(int argc, char *argv[])
+{
+  struct work *w;
+  int i, nproc, first = 1, ran = 0;
+
+  nproc = ((struct vdso*)VDSO)->ncpu;
+  if(argc > 2 && strcmp(argv[1], "-p") == 0){
+    nproc = atoi(argv[2]);
+    first = 3;
+  }
+  if(nproc < 1 || nproc > 99){
+    printf("usage: scalebench [-p nproc] [name...]\n");
+    exit(1);
+  }
+
+  for(w = works; w->s != 0; w++){
+    if(argc > first){
+      for(i = first; i < argc; i++)
+        if(strcmp(argv[i], w->s) == 0)
+          break;
+      if(i == argc)
+        continue;
+    }
+    run(w, nproc);
+    ran++;
+  }
+  if(ran == 0){
+    printf("usage: scalebench [-p nproc] [name...]\n");
+    exit(1);
+  }
+  printf("bench: done\n");
+  exit(0);
+}
@@ -1,5 +1,6 @@
 // Shell.
 
+#include "kernel/param.h"
 #include "kernel/types.h"
 #include "user/user.h"
 #include "kernel/fcntl.h"
@@ -52,7 +53,9 @@ struct backcmd {
 int fork1(void);  // Fork but panics on failure.
 void panic(char*);
 struct cmd *parsecmd(char*);
+void freecmd(struct cmd*);
 void runcmd(struct cmd*) __attribute__((noreturn));
+int parseerr;     // set by parsecmd() on a syntax error
 
 // Execute cmd.  Never returns.
 void
@@ -131,6 +134,103 @@ runcmd(struct cmd *cmd)
   exit(0);
 }
 
+// Add a file action for spawn() to fa.
+void
+addfa(struct spawnfa *fa, int *nfa, int op, int fd, int arg, char *path)
+{
+  if(*nfa >= MAXSPAWNFA)
+    panic("too many redirections");
+  fa[*nfa].op = op;
+  fa[*nfa].fd = fd;
+  fa[*nfa].arg = arg;
+  fa[*nfa].path = path;
+  (*nfa)++;
+}
+
+// Carry out file actions in a forked child, the way
+// spawn() would.
+void
+dofa(struct spawnfa *fa, int nfa)
+{
+  for(int i = 0; i < nfa; i++){
+    switch(fa[i].op){
+    case SPAWN_OPEN:
+      close(fa[i].fd);
+      if(open(fa[i].path, fa[i].arg) < 0){
+        fprintf(2, "open %s failed\n", fa[i].path);
+        exit(1);
+      }
+      break;
+    case SPAWN_DUP:
+      close(fa[i].fd);
+      dup(fa[i].arg);
+      break;
+    case SPAWN_CLOSE:
+      close(fa[i].fd);
+      break;
+    }
+  }
+}
+
+// Start cmd from the shell itself, using spawn() rather than
+// fork() and exec() where it can, with file actions fa[0..nfa)
+// for each process it starts. fa must have room for
+// MAXSPAWNFA. Returns the number of children to wait for.
+int
+spawncmd(struct cmd *cmd, struct spawnfa *fa, int nfa)
+{
+  int p[2], n;
+  struct execcmd *ecmd;
+  struct pipecmd *pcmd;
+  struct redircmd *rcmd;
+
+  if(cmd == 0)
+    return 0;
+
+  switch(cmd->type){
+  case EXEC:
+    ecmd = (struct execcmd*)cmd;
+    if(ecmd->argv[0] == 0)
+      return 0;
+    if(spawn(ecmd->argv[0], ecmd->argv, fa, nfa) < 0){
+      fprintf(2, "exec %s failed\n", ecmd->argv[0]);
+      return 0;
+    }
+    return 1;
+
+  case REDIR:
+    rcmd = (struct redircmd*)cmd;
+    addfa(fa, &nfa, SPAWN_OPEN, rcmd->fd, rcmd->mode, rcmd->file);
+    return spawncmd(rcmd->cmd, fa, nfa);
+
+  case PIPE:
+    pcmd = (struct pipecmd*)cmd;
+    if(pipe(p) < 0){
+      fprintf(2, "pipe failed\n");
+      return 0;
+    }
+    n = nfa;
+    addfa(fa, &n, SPAWN_DUP, 1, p[1], 0);
+    addfa(fa, &n, SPAWN_CLOSE, p[0], 0, 0);
+    addfa(fa, &n, SPAWN_CLOSE, p[1], 0, 0);
+    n = spawncmd(pcmd->left, fa, n);
+    fa[nfa].fd = 0;
+    fa[nfa].arg = p[0];
+    n += spawncmd(pcmd->right, fa, nfa+3);
+    close(p[0]);
+    close(p[1]);
+    return n;
+
+  default:
+    // lists and background commands need a shell of their own.
+    if(fork1() == 0){
+      dofa(fa, nfa);
+      runcmd(cmd);
+    }
+    return 1;
+  }
+}
+
 int
 getcmd(char *buf, int nbuf)
 {
@@ -146,7 +246,9 @@ int
 main(void)
 {
   static char buf[100];
-  int fd;
+  static struct spawnfa fa[MAXSPAWNFA];
+  struct cmd *cmd;
+  int fd, n;
 
   // Ensure that three file descriptors are open.
   while((fd = open("console", O_RDWR)) >= 0){
@@ -165,9 +267,12 @@ main(void)
         fprintf(2, "cannot cd %s\n", buf+3);
       continue;
     }
-    if(fork1() == 0)
-      runcmd(parsecmd(buf));
-    wait(0);
+    cmd = parsecmd(buf);
+    if(!parseerr){
+      for(n = spawncmd(cmd, fa, 0); n > 0; n--)
+        wait(0);
+    }
+    freecmd(cmd);
   }
   exit(0);
 }
@@ -257,6 +362,33 @@ backcmd(struct cmd *subcmd)
   cmd->cmd = subcmd;
   return (struct cmd*)cmd;
 }
+
+// Free cmd and its subcommands, since the shell
+// itself now parses every line.
+void
+freecmd(struct cmd *cmd)
+{
+  if(cmd == 0)
+    return;
+
+  switch(cmd->type){
+  case REDIR:
+    freecmd(((struct redircmd*)cmd)->cmd);
+    break;
+  case PIPE:
+    freecmd(((struct pipecmd*)cmd)->left);
+    freecmd(((struct pipecmd*)cmd)->right);
+    break;
+  case LIST:
+    freecmd(((struct listcmd*)cmd)->left);
+    freecmd(((struct listcmd*)cmd)->right);
+    break;
+  case BACK:
+    freecmd(((struct backcmd*)cmd)->cmd);
+    break;
+  }
+  free(cmd);
+}
 //PAGEBREAK!
 // Parsing
 
@@ -320,6 +452,16 @@ peek(char **ps, char *es, char *toks)
   return *s && strchr(toks, *s);
 }
 
+// Report a syntax error. The shell parses commands itself,
+// so it must not exit.
+void
+syntax(char *s)
+{
+  if(!parseerr)
+    fprintf(2, "%s\n", s);
+  parseerr = 1;
+}
+
 struct cmd *parseline(char**, char*);
 struct cmd *parsepipe(char**, char*);
 struct cmd *parseexec(char**, char*);
@@ -331,12 +473,13 @@ parsecmd(char *s)
   char *es;
   struct cmd *cmd;
 
+  parseerr = 0;
   es = s + strlen(s);
   cmd = parseline(&s, es);
   peek(&s, es, "");
-  if(s != es){
+  if(s != es && !parseerr){
     fprintf(2, "leftovers: %s\n", s);
-    panic("syntax");
+    syntax("syntax");
   }
   nulterminate(cmd);
   return cmd;
@@ -380,8 +523,10 @@ parseredirs(struct cmd *cmd, char **ps, char *es)
 
   while(peek(ps, es, "<>")){
     tok = gettoken(ps, es, 0, 0);
-    if(gettoken(ps, es, &q, &eq) != 'a')
-      panic("missing file for redirection");
+    if(gettoken(ps, es, &q, &eq) != 'a'){
+      syntax("missing file for redirection");
+      break;
+    }
     switch(tok){
     case '<':
       cmd = redircmd(cmd, q, eq, O_RDONLY, 0);
@@ -406,8 +551,10 @@ parseblock(char **ps, char *es)
     panic("parseblock");
   gettoken(ps, es, 0, 0);
   cmd = parseline(ps, es);
-  if(!peek(ps, es, ")"))
-    panic("syntax - missing )");
+  if(!peek(ps, es, ")")){
+    syntax("syntax - missing )");
+    return cmd;
+  }
   gettoken(ps, es, 0, 0);
   cmd = parseredirs(cmd, ps, es);
   return cmd;
@@ -432,13 +579,17 @@ parseexec(char **ps, char *es)
   while(!peek(ps, es, "|)&;")){
     if((tok=gettoken(ps, es, &q, &eq)) == 0)
       break;
-    if(tok != 'a')
-      panic("syntax");
+    if(tok != 'a'){
+      syntax("syntax");
+      break;
+    }
+    if(argc >= MAXARGS-1){
+      syntax("too many args");
+      break;
+    }
     cmd->argv[argc] = q;
     cmd->eargv[argc] = eq;
     argc++;
-    if(argc >= MAXARGS)
-      panic("too many args");
     ret = parseredirs(ret, ps, es);
   }
   cmd->argv[argc] = 0;
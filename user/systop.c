@@ -0,0 +1,143 @@
+//
+// systop [-p pid] [-h] [interval [count]]: show which system
+// calls take the most time, busiest first. With no interval,
+// shows totals since boot; otherwise shows what happened in
+// each interval ticks, count times (forever if count is 0).
+// -p shows only the calls made by process pid, and -h adds a
+// histogram of each call's latency. The max column is always
+// the longest call since boot.
+//
+
+#include "kernel/types.h"
+#include "kernel/stat.h"
+#include "kernel/param.h"
+#include "kernel/riscv.h"
+#include "kernel/memlayout.h"
+#include "kernel/sysstat.h"
+#include "user/user.h"
+
+struct sysstat old[NSYSCALL], cur[NSYSCALL], diff[NSYSCALL];
+int hflag;
+
+// print v right-aligned in a field w wide.
+void
+putnum(uint64 v, int w)
+{
+  char buf[24];
+  int i = sizeof(buf) - 1;
+
+  buf[i] = 0;
+  do {
+    buf[--i] = '0' + v % 10;
+    v /= 10;
+  } while(v != 0 && i > 0);
+  while(sizeof(buf) - 1 - i < w && i > 0)
+    buf[--i] = ' ';
+  printf("%s", buf + i);
+}
+
+// print s left-aligned in a field w wide.
+void
+putstr(char *s, int w)
+{
+  printf("%s", s);
+  for(int n = strlen(s); n < w; n++)
+    printf(" ");
+}
+
+uint64
+usec(uint64 t)
+{
+  return t * 1000000 / ((struct vdso*)VDSO)->timebase;
+}
+
+uint64
+nsec(uint64 t)
+{
+  return t * 1000000000 / ((struct vdso*)VDSO)->timebase;
+}
+
+void
+show(int n)
+{
+  struct sysstat *s, *best;
+  uint64 total = 0;
+  int i;
+
+  // what changed since old.
+  for(s = diff; s < diff + n; s++){
+    *s = cur[s-diff];
+    s->count -= old[s-diff].count;
+    s->time -= old[s-diff].time;
+    for(i = 0; i < NSYSHIST; i++)
+      s->hist[i] -= old[s-diff].hist[i];
+    total += s->time;
+  }
+
+  printf("syscall        calls   total us   avg us   max us      %%\n");
+  for(;;){
+    best = 0;
+    for(s = diff; s < diff + n; s++)
+      if(s->count > 0 && (best == 0 || s->time > best->time))
+        best = s;
+    if(best == 0)
+      break;
+    putstr(best->name, 10);
+    putnum(best->count, 10);
+    putnum(usec(best->time), 11);
+    putnum(usec(best->time / best->count), 9);
+    putnum(usec(best->max), 9);
+    putnum(total ? best->time * 100 / total : 0, 7);
+    printf("\n");
+    if(hflag){
+      for(i = 0; i < NSYSHIST; i++){
+        if(best->hist[i] == 0)
+          continue;
+        printf("    >= ");
+        putnum(i == 0 ? 0 : nsec(1L << i), 10);
+        printf(" ns ");
+        putnum(best->hist[i], 10);
+        printf("\n");
+      }
+    }
+    best->count = 0;
+  }
+}
+
+int
+main(int argc, char *argv[])
+{
+  int pid = 0, interval = 0, count = 0, i, n;
+
+  for(i = 1; i < argc && argv[i][0] == '-'; i++){
+    if(strcmp(argv[i], "-h") == 0){
+      hflag = 1;
+    } else if(strcmp(argv[i], "-p") == 0 && i+1 < argc){
+      pid = atoi(argv[++i]);
+    } else {
+      fprintf(2, "usage: systop [-p pid] [-h] [interval [count]]\n");
+      exit(1);
+    }
+  }
+  if(i < argc)
+    interval = atoi(argv[i++]);
+  if(i < argc)
+    count = atoi(argv[i++]);
+
+  if((n = sysstat(pid, cur, NSYSCALL)) < 0){
+    fprintf(2, "systop: no process %d\n", pid);
+    exit(1);
+  }
+  if(interval <= 0){
+    show(n);
+    exit(0);
+  }
+  for(i = 0; count == 0 || i < count; i++){
+    memmove(old, cur, sizeof(cur));
+    sleep(interval);
+    if((n = sysstat(pid, cur, NSYSCALL)) < 0)
+      break;
+    show(n);
+  }
+  exit(0);
+}
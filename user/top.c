@@ -0,0 +1,122 @@
+//
+// top [interval [count]]: every interval ticks (10 by
+// default), list the processes that used the CPU in that
+// time, busiest first, count times (forever if count is 0
+// or missing). %CPU is of one hart, so a process that kept
+// two harts busy shows 200.
+//
+
+#include "kernel/types.h"
+#include "kernel/stat.h"
+#include "kernel/param.h"
+#include "kernel/riscv.h"
+#include "kernel/memlayout.h"
+#include "kernel/procinfo.h"
+#include "user/user.h"
+
+struct procinfo *old, *cur;
+int nold, ncur;
+char shown[NPROC];
+
+// print v right-aligned in a field w wide.
+void
+putnum(uint64 v, int w)
+{
+  char buf[24];
+  int i = sizeof(buf) - 1;
+
+  buf[i] = 0;
+  do {
+    buf[--i] = '0' + v % 10;
+    v /= 10;
+  } while(v != 0 && i > 0);
+  while(sizeof(buf) - 1 - i < w && i > 0)
+    buf[--i] = ' ';
+  printf("%s", buf + i);
+}
+
+// CPU time p used since the last snapshot.
+uint64
+used(struct procinfo *p)
+{
+  for(int i = 0; i < nold; i++)
+    if(old[i].pid == p->pid)
+      return p->utime + p->stime - old[i].utime - old[i].stime;
+  return p->utime + p->stime;
+}
+
+void
+show(uint64 elapsed)
+{
+  struct procinfo *p, *best;
+  uint64 u, bestu, total = 0;
+  int nrun = 0;
+
+  for(p = cur; p < cur + ncur; p++){
+    total += used(p);
+    if(p->state == PI_RUNNING || p->state == PI_RUNNABLE)
+      nrun++;
+  }
+  printf("\n%d processes, %d runnable, %l%% CPU\n", ncur, nrun,
+         elapsed ? total * 100 / elapsed : 0);
+  printf("  PID  %%CPU SWITCH  FAULT   RSS NAME\n");
+  memset(shown, 0, sizeof(shown));
+  for(;;){
+    best = 0;
+    bestu = 0;
+    for(p = cur; p < cur + ncur; p++){
+      if(shown[p - cur])
+        continue;
+      if((u = used(p)) > bestu){
+        best = p;
+        bestu = u;
+      }
+    }
+    if(best == 0)
+      break;
+    putnum(best->pid, 5);
+    putnum(elapsed ? bestu * 100 / elapsed : 0, 6);
+    putnum(best->nvcsw + best->nivcsw, 7);
+    putnum(best->faults, 7);
+    putnum(best->rss, 6);
+    printf(" %s\n", best->name);
+    shown[best - cur] = 1;
+  }
+}
+
+int
+main(int argc, char *argv[])
+{
+  struct procinfo *t;
+  int interval = 10, count = 0;
+  uint64 t0, t1;
+
+  if(argc > 1)
+    interval = atoi(argv[1]);
+  if(argc > 2)
+    count = atoi(argv[2]);
+  if(interval <= 0){
+    fprintf(2, "usage: top [interval [count]]\n");
+    exit(1);
+  }
+  old = malloc(NPROC * sizeof(*old));
+  cur = malloc(NPROC * sizeof(*cur));
+  if(old == 0 || cur == 0 || (ncur = getprocinfo(cur, NPROC)) < 0){
+    fprintf(2, "top: getprocinfo failed\n");
+    exit(1);
+  }
+  t0 = r_time();
+  for(int i = 0; count == 0 || i < count; i++){
+    t = old;
+    old = cur;
+    cur = t;
+    nold = ncur;
+    sleep(interval);
+    if((ncur = getprocinfo(cur, NPROC)) < 0)
+      break;
+    t1 = r_time();
+    show(t1 - t0);
+    t0 = t1;
+  }
+  exit(0);
+}
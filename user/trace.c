@@ -0,0 +1,191 @@
+//
+// trace command [args...]: run command with the kernel's
+// tracepoints on, then print what happened while it ran, one
+// event per line:
+//
+//   <usec> cpu<n> pid<n> <event> [details]
+//
+// Times are microseconds since the first event. The trace
+// covers the whole machine, not just command. trace keeps
+// the records in memory until command exits, so that
+// printing them doesn't add events of its own.
+//
+
+#include "kernel/types.h"
+#include "kernel/stat.h"
+#include "kernel/spinlock.h"
+#include "kernel/sleeplock.h"
+#include "kernel/fs.h"
+#include "kernel/file.h"
+#include "user/user.h"
+#include "kernel/fcntl.h"
+#include "kernel/poll.h"
+#include "kernel/riscv.h"
+#include "kernel/memlayout.h"
+#include "kernel/trace.h"
+
+#define MAXREC 16384  // records kept
+
+char *syscallnames[] = {
+  [1] "fork", "exit", "wait", "pipe", "read", "kill", "exec",
+  "fstat", "chdir", "dup", "getpid", "sbrk", "sleep", "uptime",
+  "open", "write", "mknod", "unlink", "link", "mkdir", "close",
+  "ringsetup", "ringenter", "readv", "writev", "pread", "pwrite",
+  "poll", "fcntl", "spawn", "sysstat", "perfopen", "perfread",
+  "getprocinfo",
+};
+
+struct tracerec *recs;
+int nrec, nover;
+
+void
+drain(int fd)
+{
+  static struct tracerec buf[64];
+  int n, i;
+
+  while((n = read(fd, buf, sizeof(buf))) > 0){
+    for(i = 0; i < n / sizeof(buf[0]); i++){
+      if(nrec < MAXREC)
+        recs[nrec++] = buf[i];
+      else
+        nover++;
+    }
+  }
+}
+
+// reads return records merged from the CPUs' rings in time
+// order, but a record can still turn up in a later read than
+// a newer one from another CPU. they are nearly in order, so
+// insertion sort is quick.
+void
+sortrecs(void)
+{
+  struct tracerec e;
+  int i, j;
+
+  for(i = 1; i < nrec; i++){
+    e = recs[i];
+    for(j = i; j > 0 && recs[j-1].time > e.time; j--)
+      recs[j] = recs[j-1];
+    recs[j] = e;
+  }
+}
+
+char*
+syscallname(uint64 num)
+{
+  if(num < sizeof(syscallnames)/sizeof(syscallnames[0]) && syscallnames[num])
+    return syscallnames[num];
+  return "?";
+}
+
+void
+show(struct tracerec *e, uint64 t0)
+{
+  uint64 hz = ((struct vdso*)VDSO)->timebase;
+
+  printf("%l cpu%d pid%d ", (e->time - t0) * 1000000 / hz, e->cpu, e->pid);
+  switch(e->event){
+  case TR_LOST:
+    printf("lost %l records\n", e->a0);
+    break;
+  case TR_SWITCH:
+    printf("switch to pid%l\n", e->a0);
+    break;
+  case TR_SLEEP:
+    printf("sleep %p\n", e->a0);
+    break;
+  case TR_WAKEUP:
+    printf("wakeup %p pid%l\n", e->a0, e->a1);
+    break;
+  case TR_BHIT:
+    printf("bread hit %l\n", e->a0);
+    break;
+  case TR_BMISS:
+    printf("bread miss %l\n", e->a0);
+    break;
+  case TR_BRELSE:
+    printf("brelse %l\n", e->a0);
+    break;
+  case TR_DISKSTART:
+    printf("disk %s %l\n", e->a1 ? "write" : "read", e->a0);
+    break;
+  case TR_DISKDONE:
+    printf("disk done %l\n", e->a0);
+    break;
+  case TR_BEGINOP:
+    printf("begin_op\n");
+    break;
+  case TR_ENDOP:
+    printf("end_op\n");
+    break;
+  case TR_COMMIT:
+    printf("commit %l blocks\n", e->a0);
+    break;
+  case TR_SYSENTER:
+    printf("syscall %s\n", syscallname(e->a0));
+    break;
+  case TR_SYSEXIT:
+    printf("syscall %s = %d\n", syscallname(e->a0), (int)e->a1);
+    break;
+  default:
+    printf("event %d\n", e->event);
+  }
+}
+
+int
+main(int argc, char *argv[])
+{
+  int fd, p[2], i;
+  struct pollfd pfd;
+  struct spawnfa fa;
+
+  if(argc < 2){
+    fprintf(2, "usage: trace command [args...]\n");
+    exit(1);
+  }
+
+  if((fd = open("/trace", O_RDWR)) < 0){
+    mknod("/trace", TRACEDEV, 0);
+    fd = open("/trace", O_RDWR);
+  }
+  if(fd < 0 || (recs = malloc(MAXREC * sizeof(*recs))) == 0){
+    fprintf(2, "trace: cannot open /trace\n");
+    exit(1);
+  }
+
+  // command holds the write end of p, so the read end sees
+  // end-of-file once command, and anything it starts, exits.
+  if(pipe(p) < 0){
+    fprintf(2, "trace: pipe failed\n");
+    exit(1);
+  }
+  fa.op = SPAWN_CLOSE;
+  fa.fd = p[0];
+  write(fd, "1", 1);
+  if(spawn(argv[1], argv + 1, &fa, 1) < 0){
+    write(fd, "0", 1);
+    fprintf(2, "trace: cannot run %s\n", argv[1]);
+    exit(1);
+  }
+  close(p[1]);
+
+  pfd.fd = p[0];
+  pfd.events = POLLIN;
+  for(;;){
+    drain(fd);
+    if(poll(&pfd, 1, 1) > 0 && read(p[0], &i, 1) <= 0)
+      break;
+  }
+  write(fd, "0", 1);
+  drain(fd);
+  wait(0);
+
+  sortrecs();
+  for(i = 0; i < nrec; i++)
+    show(&recs[i], recs[0].time);
+  if(nover)
+    printf("trace: %d more records not kept\n", nover);
+  exit(0);
+}
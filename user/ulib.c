@@ -2,6 +2,8 @@
 #include "kernel/stat.h"
 #include "kernel/fcntl.h"
 #include "user/user.h"
+#include "kernel/riscv.h"
+#include "kernel/memlayout.h"
 
 //
 // wrapper so that it's OK if main() does not call exit().
@@ -145,3 +147,27 @@ memcpy(void *dst, const void *src, uint n)
 {
   return memmove(dst, src, n);
 }
+
+// getpid() and uptime() read pages that the kernel maps into
+// every process, rather than making a system call.
+int
+getpid(void)
+{
+  return ((struct usyscall*)USYSCALL)->pid;
+}
+
+int
+uptime(void)
+{
+  return ((struct vdso*)VDSO)->ticks;
+}
+
+// nanoseconds since boot, from the time CSR.
+uint64
+uptimens(void)
+{
+  uint64 t = r_time();
+  uint64 hz = ((struct vdso*)VDSO)->timebase;
+
+  return t / hz * 1000000000 + t % hz * 1000000000 / hz;
+}
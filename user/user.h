@@ -1,4 +1,11 @@
 struct stat;
+struct ring;
+struct iovec;
+struct pollfd;
+struct spawnfa;
+struct sysstat;
+struct perfregion;
+struct procinfo;
 
 // system calls
 int fork(void);
@@ -18,10 +25,23 @@ int link(const char*, const char*);
 int mkdir(const char*);
 int chdir(const char*);
 int dup(int);
-int getpid(void);
+int sys_getpid(void);
 char* sbrk(int);
 int sleep(int);
-int uptime(void);
+int sys_uptime(void);
+struct ring* ringsetup(void);
+int ringenter(void);
+int readv(int, const struct iovec*, int);
+int writev(int, const struct iovec*, int);
+int pread(int, void*, int, int);
+int pwrite(int, const void*, int, int);
+int poll(struct pollfd*, int, int);
+int fcntl(int, int, int);
+int spawn(const char*, char**, const struct spawnfa*, int);
+int sysstat(int, struct sysstat*, int);
+int perfopen(uint64*, int);
+int perfread(uint64*, int);
+int getprocinfo(struct procinfo*, int);
 
 // ulib.c
 int stat(const char*, struct stat*);
@@ -37,5 +57,13 @@ void* memset(void*, int, uint);
 void* malloc(uint);
 void free(void*);
 int atoi(const char*);
+int getpid(void);
+int uptime(void);
+uint64 uptimens(void);
 int memcmp(const void *, const void *, uint);
 void *memcpy(void *, const void *, uint);
+
+// perf.c
+void perfbegin(struct perfregion*);
+void perfend(struct perfregion*);
+void perfreport(struct perfregion*);
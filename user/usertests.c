@@ -3,10 +3,23 @@
 #include "kernel/stat.h"
 #include "user/user.h"
 #include "kernel/fs.h"
+#include "kernel/spinlock.h"
+#include "kernel/sleeplock.h"
+#include "kernel/file.h"
 #include "kernel/fcntl.h"
 #include "kernel/syscall.h"
 #include "kernel/memlayout.h"
 #include "kernel/riscv.h"
+#include "kernel/ring.h"
+#include "kernel/poll.h"
+#include "kernel/prof.h"
+#include "kernel/trace.h"
+#include "kernel/sysstat.h"
+#include "kernel/perf.h"
+#include "kernel/iostat.h"
+#include "kernel/memstat.h"
+#include "kernel/lockstat.h"
+#include "kernel/procinfo.h"
 
 //
 // Tests xv6 system calls.  usertests without arguments runs them all
@@ -113,6 +126,400 @@ copyout(char *s)
   }
 }
 
+// reads through the page cache see every write, including
+// ones that straddle pages, and truncation.
+void
+pagecache(char *s)
+{
+  static char buf[3*4096];
+  char b[8];
+  int fd, i;
+
+  for(i = 0; i < sizeof(buf); i++)
+    buf[i] = i % 251;
+  fd = open("pagecache", O_CREATE|O_RDWR);
+  if(fd < 0 || write(fd, buf, sizeof(buf)) != sizeof(buf)){
+    printf("%s: write failed\n", s);
+    exit(1);
+  }
+  // read everything into the cache, then change it.
+  if(pread(fd, buf, sizeof(buf), 0) != sizeof(buf)){
+    printf("%s: read failed\n", s);
+    exit(1);
+  }
+  if(pwrite(fd, "abcdefgh", 8, 4096-4) != 8 ||
+     pread(fd, b, 8, 4096-4) != 8 || memcmp(b, "abcdefgh", 8) != 0){
+    printf("%s: read didn't see write across pages\n", s);
+    exit(1);
+  }
+  if(pread(fd, b, 1, 2*4096+100) != 1 || b[0] != (2*4096+100) % 251){
+    printf("%s: wrong data\n", s);
+    exit(1);
+  }
+  close(fd);
+
+  fd = open("pagecache", O_RDWR|O_TRUNC);
+  if(fd < 0 || write(fd, "xy", 2) != 2){
+    printf("%s: truncate failed\n", s);
+    exit(1);
+  }
+  if(pread(fd, buf, sizeof(buf), 0) != 2 || buf[0] != 'x' || buf[1] != 'y'){
+    printf("%s: read stale data after truncate\n", s);
+    exit(1);
+  }
+  close(fd);
+  unlink("pagecache");
+}
+
+// the profiler catches a process spinning in user space.
+void
+proftest(char *s)
+{
+  static struct profsample ps[64];
+  int fd, n, t0, i, found = 0;
+
+  unlink("proftest");
+  if(mknod("proftest", PROF, 0) < 0 || (fd = open("proftest", O_RDWR)) < 0){
+    printf("%s: cannot make profiler device\n", s);
+    exit(1);
+  }
+  if(write(fd, "1", 1) != 1){
+    printf("%s: cannot start profiler\n", s);
+    exit(1);
+  }
+  t0 = uptime();
+  while(uptime() - t0 < 5)
+    ;
+  write(fd, "0", 1);
+  while((n = read(fd, ps, sizeof(ps))) > 0){
+    if(n % sizeof(ps[0]) != 0){
+      printf("%s: read part of a sample\n", s);
+      exit(1);
+    }
+    for(i = 0; i < n / sizeof(ps[0]); i++)
+      if(ps[i].pid == getpid() && ps[i].user && ps[i].pc < (uint64)sbrk(0))
+        found = 1;
+  }
+  close(fd);
+  unlink("proftest");
+  if(!found){
+    printf("%s: no samples of this process\n", s);
+    exit(1);
+  }
+}
+
+// system calls show up in the trace, in order.
+void
+tracetest(char *s)
+{
+  static struct tracerec tr[64];
+  int fd, n, i, enter = 0, exit_ = 0;
+
+  unlink("tracetest");
+  if(mknod("tracetest", TRACEDEV, 0) < 0 || (fd = open("tracetest", O_RDWR)) < 0){
+    printf("%s: cannot make trace device\n", s);
+    exit(1);
+  }
+  if(write(fd, "1", 1) != 1){
+    printf("%s: cannot start tracing\n", s);
+    exit(1);
+  }
+  sys_uptime();
+  write(fd, "0", 1);
+  while((n = read(fd, tr, sizeof(tr))) > 0){
+    for(i = 0; i < n / sizeof(tr[0]); i++){
+      if(tr[i].pid != getpid())
+        continue;
+      if(tr[i].event == TR_SYSENTER && tr[i].a0 == SYS_uptime)
+        enter = 1;
+      if(tr[i].event == TR_SYSEXIT && tr[i].a0 == SYS_uptime && enter)
+        exit_ = 1;
+    }
+  }
+  close(fd);
+  unlink("tracetest");
+  if(!enter || !exit_){
+    printf("%s: uptime() missing from trace\n", s);
+    exit(1);
+  }
+}
+
+// sysstat() counts this process's system calls, and everyone's.
+void
+sysstattest(char *s)
+{
+  static struct sysstat mine[NSYSCALL], all[NSYSCALL], st[NSYSCALL];
+  int i;
+
+  if(sysstat(getpid(), mine, NSYSCALL) != NSYSCALL ||
+     sysstat(0, all, NSYSCALL) != NSYSCALL){
+    printf("%s: sysstat failed\n", s);
+    exit(1);
+  }
+  for(i = 0; i < 10; i++)
+    sys_uptime();
+  if(sysstat(getpid(), st, NSYSCALL) != NSYSCALL ||
+     st[SYS_uptime].count != mine[SYS_uptime].count + 10 ||
+     strcmp(st[SYS_uptime].name, "uptime") != 0){
+    printf("%s: wrong count for this process\n", s);
+    exit(1);
+  }
+  if(sysstat(0, st, NSYSCALL) != NSYSCALL ||
+     st[SYS_uptime].count < all[SYS_uptime].count + 10 ||
+     st[SYS_uptime].time < all[SYS_uptime].time){
+    printf("%s: wrong count for all processes\n", s);
+    exit(1);
+  }
+  if(sysstat(1000000, st, NSYSCALL) != -1){
+    printf("%s: sysstat of no process succeeded\n", s);
+    exit(1);
+  }
+}
+
+// user code can read the counters, and perfread() counts
+// this process's instructions.
+void
+perftest(char *s)
+{
+  uint64 a[NPERFCTR], b[NPERFCTR];
+  volatile int x = 0;
+
+  // these trap if user mode can't read the counters.
+  r_cycle();
+  r_instret();
+  if(perfread(a, NPERFCTR) != -1){
+    printf("%s: perfread before perfopen succeeded\n", s);
+    exit(1);
+  }
+  if(perfopen(0, 0) < 0 || perfread(a, NPERFCTR) != NPERFCTR){
+    printf("%s: perfopen failed\n", s);
+    exit(1);
+  }
+  for(int i = 0; i < 100000; i++)
+    x++;
+  if(perfread(b, NPERFCTR) != NPERFCTR){
+    printf("%s: perfread failed\n", s);
+    exit(1);
+  }
+  if(b[PERF_INSTRET] - a[PERF_INSTRET] < 100000 ||
+     b[PERF_CYCLE] <= a[PERF_CYCLE]){
+    printf("%s: counters didn't count\n", s);
+    exit(1);
+  }
+}
+
+// writing a file shows up in the log and disk statistics.
+void
+iostattest(char *s)
+{
+  struct iostats a, b;
+  int fd, sfd;
+
+  unlink("iostattest");
+  if(mknod("iostattest", IOSTATS, 0) < 0 || (sfd = open("iostattest", O_RDONLY)) < 0){
+    printf("%s: cannot make statistics device\n", s);
+    exit(1);
+  }
+  if(read(sfd, &a, sizeof(a)) != sizeof(a)){
+    printf("%s: read failed\n", s);
+    exit(1);
+  }
+  fd = open("iostattest.f", O_CREATE|O_WRONLY);
+  if(fd < 0 || write(fd, "x", 1) != 1){
+    printf("%s: write failed\n", s);
+    exit(1);
+  }
+  close(fd);
+  unlink("iostattest.f");
+  if(read(sfd, &b, sizeof(b)) != sizeof(b)){
+    printf("%s: read failed\n", s);
+    exit(1);
+  }
+  if(b.ops <= a.ops || b.commits <= a.commits || b.logblocks <= a.logblocks ||
+     b.dwrites <= a.dwrites || b.bhits + b.bmisses <= a.bhits + a.bmisses){
+    printf("%s: statistics didn't change\n", s);
+    exit(1);
+  }
+  if(read(sfd, &a, 1) != -1){
+    printf("%s: short read succeeded\n", s);
+    exit(1);
+  }
+  close(sfd);
+  unlink("iostattest");
+}
+
+// growing memory takes zeroed pages, and the allocator counts
+// where they came from, even when they are pages just freed
+// with other contents.
+void
+memstattest(char *s)
+{
+  struct memstats a, b;
+  char *p;
+  int fd, i, n = 32;
+
+  unlink("memstattest");
+  if(mknod("memstattest", MEMSTATS, 0) < 0 || (fd = open("memstattest", O_RDONLY)) < 0){
+    printf("%s: cannot make statistics device\n", s);
+    exit(1);
+  }
+  if(read(fd, &a, sizeof(a)) != sizeof(a)){
+    printf("%s: read failed\n", s);
+    exit(1);
+  }
+  p = sbrk(n*PGSIZE);
+  if(p == (char*)-1){
+    printf("%s: sbrk failed\n", s);
+    exit(1);
+  }
+  memset(p, 0xab, n*PGSIZE);
+  sbrk(-n*PGSIZE);
+  p = sbrk(n*PGSIZE);
+  if(p == (char*)-1){
+    printf("%s: sbrk failed\n", s);
+    exit(1);
+  }
+  for(i = 0; i < n*PGSIZE; i++){
+    if(p[i] != 0){
+      printf("%s: page not zeroed at %d\n", s, i);
+      exit(1);
+    }
+  }
+  sbrk(-n*PGSIZE);
+  if(read(fd, &b, sizeof(b)) != sizeof(b)){
+    printf("%s: read failed\n", s);
+    exit(1);
+  }
+  if(b.zhits + b.zmisses < a.zhits + a.zmisses + 2*n){
+    printf("%s: statistics didn't count\n", s);
+    exit(1);
+  }
+  if(b.zeroed > NZEROPAGE || b.zfills < b.zhits){
+    printf("%s: bad pool counts\n", s);
+    exit(1);
+  }
+  close(fd);
+  unlink("memstattest");
+}
+
+// a LOCKSTAT kernel counts pipe lock acquisitions. other
+// kernels have no statistics to read.
+void
+lockstattest(char *s)
+{
+  struct lockstat *st, *l;
+  int sfd, p[2], n;
+  char c;
+
+  unlink("lockstattest");
+  if(mknod("lockstattest", LOCKSTATDEV, 0) < 0 || (sfd = open("lockstattest", O_RDWR)) < 0){
+    printf("%s: cannot make statistics device\n", s);
+    exit(1);
+  }
+  if((st = malloc(NLOCKSTAT * sizeof(*st))) == 0){
+    printf("%s: malloc failed\n", s);
+    exit(1);
+  }
+  if(write(sfd, "0", 1) != 1){
+    printf("%s: reset failed\n", s);
+    exit(1);
+  }
+  if(pipe(p) < 0 || write(p[1], "x", 1) != 1 || read(p[0], &c, 1) != 1){
+    printf("%s: pipe failed\n", s);
+    exit(1);
+  }
+  close(p[0]);
+  close(p[1]);
+  n = read(sfd, st, NLOCKSTAT * sizeof(*st));
+  if(n < 0 || n % sizeof(*st) != 0){
+    printf("%s: read returned %d\n", s, n);
+    exit(1);
+  }
+  if(n > 0){
+    for(l = st; l < st + n / sizeof(*st); l++)
+      if(strcmp(l->name, "pipe") == 0 && !l->sleep)
+        break;
+    if(l == st + n / sizeof(*st) || l->acquires < 2){
+      printf("%s: pipe lock not counted\n", s);
+      exit(1);
+    }
+  }
+  free(st);
+  close(sfd);
+  unlink("lockstattest");
+}
+
+// getprocinfo() describes this process and its child.
+void
+procinfotest(char *s)
+{
+  struct procinfo *pi, *me = 0, *kid = 0;
+  int pid, fds[2], n, i, t0;
+  char c;
+
+  if((pi = malloc(NPROC * sizeof(*pi))) == 0 || pipe(fds) < 0){
+    printf("%s: malloc or pipe failed\n", s);
+    exit(1);
+  }
+  pid = fork();
+  if(pid < 0){
+    printf("%s: fork failed\n", s);
+    exit(1);
+  }
+  if(pid == 0){
+    read(fds[0], &c, 1);
+    exit(0);
+  }
+  write(fds[1], "ab", 2);
+  read(fds[0], &c, 1);
+  t0 = uptime();
+  while(uptime() - t0 < 2)
+    ;
+
+  n = getprocinfo(pi, NPROC);
+  for(i = 0; i < n; i++){
+    if(pi[i].pid == getpid())
+      me = &pi[i];
+    if(pi[i].pid == pid)
+      kid = &pi[i];
+  }
+  if(me == 0 || kid == 0){
+    printf("%s: process missing from getprocinfo\n", s);
+    exit(1);
+  }
+  if(kid->ppid != getpid() || me->state != PI_RUNNING || me->rss == 0 ||
+     me->utime == 0 || me->wbytes < 2 || me->rbytes < 1 ||
+     me->sz != (uint64)sbrk(0)){
+    printf("%s: wrong information\n", s);
+    exit(1);
+  }
+  close(fds[0]);
+  close(fds[1]);
+  wait(0);
+}
+
+// a system call must not write into the program's text,
+// which exec() shares with every other process running it.
+void
+textro(char *s)
+{
+  char *text = (char*)textro, save[8];
+  int fd, n;
+
+  memmove(save, text, sizeof(save));
+  fd = open("README", 0);
+  if(fd < 0){
+    printf("open(README) failed\n");
+    exit(1);
+  }
+  n = read(fd, text, sizeof(save));
+  if(n > 0 || memcmp(save, text, sizeof(save)) != 0){
+    printf("%s: read into text returned %d\n", s, n);
+    exit(1);
+  }
+  close(fd);
+}
+
 // what if you pass ridiculous string pointers to system calls?
 void
 copyinstr1(char *s)
@@ -730,6 +1137,72 @@ exectest(char *s)
 
 }
 
+// spawn() echo with its output redirected to a file and a
+// pipe's read end closed, and check that a failed spawn
+// leaves no child.
+void
+spawntest(char *s)
+{
+  char *echoargv[] = { "echo", "OK", 0 };
+  struct spawnfa fa[3];
+  int fds[2], pid, xstatus, fd;
+  char buf[3];
+
+  if(pipe(fds) < 0){
+    printf("%s: pipe failed\n", s);
+    exit(1);
+  }
+  fa[0].op = SPAWN_OPEN;
+  fa[0].fd = 1;
+  fa[0].arg = O_CREATE|O_WRONLY;
+  fa[0].path = "spawn-ok";
+  fa[1].op = SPAWN_DUP;
+  fa[1].fd = fds[0] + 100;
+  fa[1].arg = fds[1];
+  fa[2].op = SPAWN_CLOSE;
+  fa[2].fd = fds[1];
+  pid = spawn("echo", echoargv, fa, 3);
+  if(pid < 0){
+    printf("%s: spawn failed\n", s);
+    exit(1);
+  }
+  close(fds[1]);
+  // the child's copy of the write end is at fds[0]+100, and
+  // goes away when it exits.
+  if(read(fds[0], buf, 1) != 0){
+    printf("%s: read from the pipe\n", s);
+    exit(1);
+  }
+  if(wait(&xstatus) != pid || xstatus != 0){
+    printf("%s: wait failed\n", s);
+    exit(1);
+  }
+  close(fds[0]);
+
+  fd = open("spawn-ok", O_RDONLY);
+  if(fd < 0 || read(fd, buf, 3) != 3 || buf[0] != 'O' || buf[1] != 'K'){
+    printf("%s: wrong output\n", s);
+    exit(1);
+  }
+  close(fd);
+  unlink("spawn-ok");
+
+  if(spawn("nonexistent", echoargv, 0, 0) != -1 ||
+     spawn("echo", echoargv, fa, MAXSPAWNFA+1) != -1){
+    printf("%s: bad spawn succeeded\n", s);
+    exit(1);
+  }
+  fa[0].path = "nonexistent/x";
+  if(spawn("echo", echoargv, fa, 1) != -1){
+    printf("%s: spawn with a bad open succeeded\n", s);
+    exit(1);
+  }
+  if(wait(0) != -1){
+    printf("%s: failed spawn left a child\n", s);
+    exit(1);
+  }
+}
+
 // simple fork and pipe read/write
 
 void
@@ -929,6 +1402,59 @@ reparent(char *s)
   exit(0);
 }
 
+// kill children by pid, in the opposite order from their
+// creation, and wait for each exactly once.
+void
+killchildren(char *s)
+{
+  enum { N = 200 };
+  int pids[N], fds[2], pid, xstatus, n, i;
+  char c;
+
+  if(pipe(fds) < 0){
+    printf("%s: pipe failed\n", s);
+    exit(1);
+  }
+  for(i = 0; i < N; i++){
+    pids[i] = fork();
+    if(pids[i] < 0){
+      printf("%s: fork failed\n", s);
+      exit(1);
+    }
+    if(pids[i] == 0){
+      read(fds[0], &c, 1);
+      exit(0);
+    }
+  }
+  for(i = N-1; i >= 0; i--){
+    if(kill(pids[i]) != 0){
+      printf("%s: kill %d failed\n", s, pids[i]);
+      exit(1);
+    }
+  }
+  for(n = 0; n < N; n++){
+    pid = wait(&xstatus);
+    for(i = 0; i < N; i++)
+      if(pids[i] == pid)
+        break;
+    if(i == N || xstatus != -1){
+      printf("%s: wait returned %d\n", s, pid);
+      exit(1);
+    }
+    pids[i] = 0;
+  }
+  if(wait(0) != -1){
+    printf("%s: wait got too many\n", s);
+    exit(1);
+  }
+  if(kill(pid) != -1 || kill(-1) != -1){
+    printf("%s: killed a process that is gone\n", s);
+    exit(1);
+  }
+  close(fds[0]);
+  close(fds[1]);
+}
+
 // what if two children exit() at the same time?
 void
 twochildren(char *s)
@@ -1861,6 +2387,30 @@ rmdot(char *s)
   }
 }
 
+// leaving a directory that was removed while it was the
+// current directory frees it. chdir() runs outside any
+// transaction, so iput() has to start one.
+void
+rmcwd(char *s)
+{
+  if(mkdir("rmcwd") != 0 || chdir("rmcwd") != 0){
+    printf("%s: mkdir or chdir rmcwd failed\n", s);
+    exit(1);
+  }
+  if(unlink("../rmcwd") != 0){
+    printf("%s: unlink ../rmcwd failed\n", s);
+    exit(1);
+  }
+  if(chdir("/") != 0){
+    printf("%s: chdir / failed\n", s);
+    exit(1);
+  }
+  if(open("rmcwd", O_RDONLY) >= 0){
+    printf("%s: rmcwd still there\n", s);
+    exit(1);
+  }
+}
+
 void
 dirfile(char *s)
 {
@@ -1959,7 +2509,7 @@ iref(char *s)
 void
 forktest(char *s)
 {
-  enum{ N = 1000 };
+  enum{ N = NPROC };
   int n, pid;
 
   for(n=0; n<N; n++){
@@ -1976,7 +2526,7 @@ forktest(char *s)
   }
 
   if(n == N){
-    printf("%s: fork claimed to work 1000 times!\n", s);
+    printf("%s: fork claimed to work %d times!\n", s, N);
     exit(1);
   }
 
@@ -2165,6 +2715,351 @@ MAXVAplus(char *s)
   }
 }
 
+// queue one submission on the ring.
+void
+ringsub(struct ring *r, int op, int fd, void *addr, int n)
+{
+  struct ringsqe *e = &r->sq[r->sqtail % RING_NENT];
+
+  e->op = op;
+  e->fd = fd;
+  e->addr = (uint64)addr;
+  e->n = n;
+  e->data = r->sqtail;
+  r->sqtail++;
+}
+
+// open, write, fstat, read and close a file through the
+// submission ring, several calls per ringenter().
+void
+ring(char *s)
+{
+  struct ring *r;
+  struct stat st;
+  char buf[16];
+  int fd, i;
+
+  if(ringenter() != -1){
+    printf("%s: ringenter without a ring succeeded\n", s);
+    exit(1);
+  }
+  r = ringsetup();
+  if(r != (struct ring*)URING || ringsetup() != r){
+    printf("%s: ringsetup returned %p\n", s, r);
+    exit(1);
+  }
+
+  unlink("ringfile");
+  ringsub(r, RING_OPEN, 0, "ringfile", O_CREATE|O_RDWR);
+  if(ringenter() != 1 || r->cqtail != 1 || (fd = r->cq[0].res) < 0){
+    printf("%s: ring open failed\n", s);
+    exit(1);
+  }
+  r->cqhead++;
+
+  ringsub(r, RING_WRITE, fd, "hello", 5);
+  ringsub(r, RING_WRITE, fd, "world", 5);
+  ringsub(r, RING_FSTAT, fd, &st, 0);
+  ringsub(r, RING_FSYNC, fd, 0, 0);
+  ringsub(r, RING_CLOSE, fd, 0, 0);
+  ringsub(r, RING_READ, fd, buf, 1);
+  if(ringenter() != 6){
+    printf("%s: ringenter didn't drain\n", s);
+    exit(1);
+  }
+  int want[] = { 5, 5, 0, 0, 0, -1 };
+  for(i = 0; i < 6; i++, r->cqhead++){
+    struct ringcqe *c = &r->cq[r->cqhead % RING_NENT];
+    if(c->data != 1 + i || c->res != want[i]){
+      printf("%s: completion %d: data %d res %d\n", s, i, (int)c->data, c->res);
+      exit(1);
+    }
+  }
+  if(st.size != 10){
+    printf("%s: ring fstat size %d\n", s, (int)st.size);
+    exit(1);
+  }
+
+  fd = open("ringfile", O_RDONLY);
+  ringsub(r, RING_READ, fd, buf, 3);
+  ringsub(r, RING_READ, fd, buf+3, sizeof(buf)-3);
+  if(ringenter() != 2 || r->cq[r->cqhead % RING_NENT].res != 3 ||
+     r->cq[(r->cqhead+1) % RING_NENT].res != 7 || memcmp(buf, "helloworld", 10) != 0){
+    printf("%s: ring read failed\n", s);
+    exit(1);
+  }
+  r->cqhead += 2;
+  close(fd);
+  unlink("ringfile");
+}
+
+// readv, writev, pread and pwrite.
+void
+rwvec(char *s)
+{
+  struct iovec iov[3];
+  char a[4], b[8];
+  int fd, fds[2];
+
+  unlink("vecfile");
+  fd = open("vecfile", O_CREATE|O_RDWR);
+  if(fd < 0){
+    printf("%s: open failed\n", s);
+    exit(1);
+  }
+  iov[0].iov_base = "abc";
+  iov[0].iov_len = 3;
+  iov[1].iov_base = "";
+  iov[1].iov_len = 0;
+  iov[2].iov_base = "defgh";
+  iov[2].iov_len = 5;
+  if(writev(fd, iov, 3) != 8){
+    printf("%s: writev failed\n", s);
+    exit(1);
+  }
+  if(pwrite(fd, "XY", 2, 1) != 2 || write(fd, "!", 1) != 1){
+    printf("%s: pwrite failed\n", s);
+    exit(1);
+  }
+  if(pread(fd, b, 3, 6) != 3 || memcmp(b, "gh!", 3) != 0){
+    printf("%s: pread failed\n", s);
+    exit(1);
+  }
+  close(fd);
+
+  fd = open("vecfile", O_RDONLY);
+  iov[0].iov_base = a;
+  iov[0].iov_len = sizeof(a);
+  iov[1].iov_base = b;
+  iov[1].iov_len = sizeof(b);
+  if(readv(fd, iov, 2) != 9 || memcmp(a, "aXYd", 4) != 0 || memcmp(b, "efgh!", 5) != 0){
+    printf("%s: readv failed\n", s);
+    exit(1);
+  }
+  if(readv(fd, iov, MAXIOV+1) != -1 || readv(fd, (struct iovec*)0xffffffffffL, 1) != -1){
+    printf("%s: readv accepted bad arguments\n", s);
+    exit(1);
+  }
+  close(fd);
+  unlink("vecfile");
+
+  // pipes have no offset.
+  if(pipe(fds) < 0){
+    printf("%s: pipe failed\n", s);
+    exit(1);
+  }
+  if(pwrite(fds[1], "x", 1, 0) != -1 || pread(fds[0], b, 1, 0) != -1){
+    printf("%s: pread/pwrite on a pipe succeeded\n", s);
+    exit(1);
+  }
+
+  // a readv whose first buffer takes all there is returns,
+  // as read() would, rather than wait to fill the second.
+  write(fds[1], "abcd", 4);
+  iov[0].iov_base = a;
+  iov[0].iov_len = 4;
+  iov[1].iov_base = b;
+  iov[1].iov_len = sizeof(b);
+  if(readv(fds[0], iov, 2) != 4 || memcmp(a, "abcd", 4) != 0){
+    printf("%s: readv of a pipe failed\n", s);
+    exit(1);
+  }
+
+  // a non-blocking writev that fills the pipe part way through
+  // says how much it wrote (PIPESIZE, 512 bytes), and one to a
+  // full pipe fails.
+  fcntl(fds[1], F_SETFL, O_NONBLOCK);
+  iov[0].iov_base = buf;
+  iov[0].iov_len = 400;
+  iov[1].iov_base = buf;
+  iov[1].iov_len = 400;
+  iov[2].iov_base = buf;
+  iov[2].iov_len = 400;
+  if(writev(fds[1], iov, 3) != 512){
+    printf("%s: short writev to a pipe miscounted\n", s);
+    exit(1);
+  }
+  if(writev(fds[1], iov, 3) != -1){
+    printf("%s: writev to a full pipe succeeded\n", s);
+    exit(1);
+  }
+  close(fds[0]);
+  close(fds[1]);
+}
+
+// poll() on pipes, and non-blocking pipe reads and writes.
+void
+pollpipe(char *s)
+{
+  struct pollfd pfd[3];
+  int fds[2], pid, xstatus, t0;
+  char c;
+
+  if(pipe(fds) < 0){
+    printf("%s: pipe failed\n", s);
+    exit(1);
+  }
+  pfd[0].fd = fds[0];
+  pfd[0].events = POLLIN;
+  pfd[1].fd = fds[1];
+  pfd[1].events = POLLOUT;
+  pfd[2].fd = MAXFD-1;  // not open
+  pfd[2].events = POLLIN;
+  if(poll(pfd, 3, 0) != 2 || pfd[0].revents != 0 || pfd[1].revents != POLLOUT ||
+     pfd[2].revents != POLLNVAL){
+    printf("%s: poll of an empty pipe\n", s);
+    exit(1);
+  }
+
+  t0 = uptime();
+  if(poll(pfd, 1, 2) != 0 || uptime() - t0 < 2){
+    printf("%s: poll didn't time out\n", s);
+    exit(1);
+  }
+
+  if(fcntl(fds[0], F_SETFL, O_NONBLOCK) != 0 ||
+     fcntl(fds[0], F_GETFL, 0) != (O_RDONLY|O_NONBLOCK)){
+    printf("%s: fcntl failed\n", s);
+    exit(1);
+  }
+  if(read(fds[0], &c, 1) != -1){
+    printf("%s: non-blocking read of an empty pipe succeeded\n", s);
+    exit(1);
+  }
+
+  // a poll that waits is woken by a write in another process.
+  pid = fork();
+  if(pid < 0){
+    printf("%s: fork failed\n", s);
+    exit(1);
+  }
+  if(pid == 0){
+    sleep(2);
+    write(fds[1], "x", 1);
+    exit(0);
+  }
+  if(poll(pfd, 1, -1) != 1 || pfd[0].revents != POLLIN ||
+     read(fds[0], &c, 1) != 1 || c != 'x'){
+    printf("%s: poll didn't see the write\n", s);
+    exit(1);
+  }
+  wait(&xstatus);
+
+  // fill the pipe without blocking.
+  fcntl(fds[1], F_SETFL, O_NONBLOCK);
+  while(write(fds[1], "y", 1) == 1)
+    ;
+  if(poll(&pfd[1], 1, 0) != 0){
+    printf("%s: full pipe polled writable\n", s);
+    exit(1);
+  }
+
+  close(fds[1]);
+  if(poll(pfd, 1, 0) != 1 || pfd[0].revents != (POLLIN|POLLHUP)){
+    printf("%s: no POLLHUP after close\n", s);
+    exit(1);
+  }
+  close(fds[0]);
+}
+
+// a process can have many more than NOFILE open files,
+// and a child inherits all of them.
+void
+manyfds(char *s)
+{
+  enum { N = 300 };
+  int fd, i, pid, xstatus;
+  char c;
+
+  fd = open("manyfds", O_CREATE|O_RDWR);
+  if(fd < 0){
+    printf("%s: open failed\n", s);
+    exit(1);
+  }
+  write(fd, "x", 1);
+  for(i = 0; i < N; i++){
+    if(dup(fd) != fd+1+i){
+      printf("%s: dup %d failed\n", s, i);
+      exit(1);
+    }
+  }
+
+  pid = fork();
+  if(pid < 0){
+    printf("%s: fork failed\n", s);
+    exit(1);
+  }
+  if(pid == 0){
+    if(pread(fd+N, &c, 1, 0) != 1 || c != 'x')
+      exit(1);
+    for(i = 0; i <= N; i++)
+      if(close(fd+i) != 0)
+        exit(1);
+    exit(0);
+  }
+  wait(&xstatus);
+  if(xstatus != 0){
+    printf("%s: child couldn't use inherited fds\n", s);
+    exit(1);
+  }
+
+  // the lowest free fd is reused first.
+  close(fd+N/2);
+  close(fd+7);
+  if(dup(fd) != fd+7 || dup(fd) != fd+N/2){
+    printf("%s: dup didn't reuse the lowest fd\n", s);
+    exit(1);
+  }
+  for(i = 1; i <= N; i++)
+    close(fd+i);
+  if(dup(fd) != fd+1){
+    printf("%s: closed fds not free\n", s);
+    exit(1);
+  }
+  close(fd+1);
+  close(fd);
+  unlink("manyfds");
+}
+
+// do the vdso and usyscall pages agree with the system calls
+// they stand in for, and are they read-only?
+void
+vdso(char *s)
+{
+  int pid, xstatus;
+  uint64 ns;
+
+  if(getpid() != sys_getpid()){
+    printf("%s: getpid %d != %d\n", s, getpid(), sys_getpid());
+    exit(1);
+  }
+  if(uptime() > sys_uptime()){
+    printf("%s: uptime ahead of the kernel\n", s);
+    exit(1);
+  }
+  ns = uptimens();
+  if(uptimens() < ns){
+    printf("%s: uptimens went backwards\n", s);
+    exit(1);
+  }
+
+  pid = fork();
+  if(pid < 0){
+    printf("%s: fork failed\n", s);
+    exit(1);
+  }
+  if(pid == 0){
+    if(getpid() != sys_getpid())
+      exit(1);
+    ((struct vdso*)VDSO)->ticks = 0;
+    printf("%s: oops wrote the vdso page\n", s);
+    exit(1);
+  }
+  wait(&xstatus);
+  if(xstatus != -1)  // did kernel kill child?
+    exit(1);
+}
+
 // if we run the system out of memory, does it clean up the last
 // failed allocation?
 void
@@ -2395,8 +3290,8 @@ void argptest(char *s)
   close(fd);
 }
 
-// check that there's an invalid page beneath
-// the user stack, to catch stack overflow.
+// check that there's an invalid page beneath the
+// most the user stack may grow to, to catch stack overflow.
 void
 stacktest(char *s)
 {
@@ -2406,7 +3301,7 @@ stacktest(char *s)
   pid = fork();
   if(pid == 0) {
     char *sp = (char *) r_sp();
-    sp -= PGSIZE;
+    sp -= MAXUSTACK*PGSIZE;
     // the *sp should cause a trap.
     printf("%s: stacktest: read below stack %p\n", s, *sp);
     exit(1);
@@ -2421,6 +3316,97 @@ stacktest(char *s)
     exit(xstatus);
 }
 
+// system calls can't read or write the stack guard page
+// either.
+void
+stackguard(char *s)
+{
+  char *guard = (char*)PGROUNDDOWN(r_sp()) - MAXUSTACK*PGSIZE;
+  int fd, fds[2];
+
+  if((fd = open("README", O_RDONLY)) < 0){
+    printf("%s: open failed\n", s);
+    exit(1);
+  }
+  if(read(fd, guard, 16) != -1 || read(fd, guard + PGSIZE - 8, 16) != -1){
+    printf("%s: read into the guard page succeeded\n", s);
+    exit(1);
+  }
+  close(fd);
+
+  if(pipe(fds) < 0){
+    printf("%s: pipe failed\n", s);
+    exit(1);
+  }
+  if(write(fds[1], guard, 16) > 0){
+    printf("%s: write from the guard page succeeded\n", s);
+    exit(1);
+  }
+  close(fds[0]);
+  close(fds[1]);
+}
+
+// recurse depth levels, each with half a page of local
+// variables, so that no frame can step over the guard page.
+// returns depth, or -1 if they got mixed up.
+int
+stackdeep(int depth)
+{
+  volatile char a[PGSIZE/2];
+
+  a[0] = depth;
+  a[sizeof(a)-1] = depth;
+  if(depth > 0 && stackdeep(depth - 1) != depth - 1)
+    return -1;
+  return a[0] == a[sizeof(a)-1] ? depth : -1;
+}
+
+// read() into a large local array that nothing has touched.
+int
+stackread(int fd)
+{
+  char a[8*PGSIZE];
+
+  return read(fd, a, 16);
+}
+
+// the user stack grows as deep as MAXUSTACK pages, both when
+// the program touches it and when a system call does, and no
+// further.
+void
+stackgrow(char *s)
+{
+  int pid, fd, xstatus;
+
+  pid = fork();
+  if(pid == 0){
+    if((fd = open("README", O_RDONLY)) < 0 || stackread(fd) != 16){
+      printf("%s: read into new stack page failed\n", s);
+      exit(1);
+    }
+    if(stackdeep(MAXUSTACK) != MAXUSTACK){
+      printf("%s: deep stack corrupted\n", s);
+      exit(1);
+    }
+    exit(0);
+  }
+  wait(&xstatus);
+  if(xstatus != 0)
+    exit(1);
+
+  pid = fork();
+  if(pid == 0){
+    stackdeep(3*MAXUSTACK);
+    printf("%s: stack grew past MAXUSTACK pages\n", s);
+    exit(1);
+  }
+  wait(&xstatus);
+  if(xstatus != -1){
+    printf("%s: stack overflow not caught\n", s);
+    exit(1);
+  }
+}
+
 // check that writes to text segment fault
 void
 textwrite(char *s)
@@ -2577,6 +3563,16 @@ struct test {
 } quicktests[] = {
   {copyin, "copyin"},
   {copyout, "copyout"},
+  {textro, "textro"},
+  {pagecache, "pagecache"},
+  {proftest, "proftest"},
+  {tracetest, "tracetest"},
+  {sysstattest, "sysstattest"},
+  {perftest, "perftest"},
+  {iostattest, "iostattest"},
+  {memstattest, "memstattest"},
+  {lockstattest, "lockstattest"},
+  {procinfotest, "procinfotest"},
   {copyinstr1, "copyinstr1"},
   {copyinstr2, "copyinstr2"},
   {copyinstr3, "copyinstr3"},
@@ -2593,11 +3589,13 @@ struct test {
   {createtest, "createtest"},
   {dirtest, "dirtest"},
   {exectest, "exectest"},
+  {spawntest, "spawntest"},
   {pipe1, "pipe1"},
   {killstatus, "killstatus"},
   {preempt, "preempt"},
   {exitwait, "exitwait"},
   {reparent, "reparent" },
+  {killchildren, "killchildren"},
   {twochildren, "twochildren"},
   {forkfork, "forkfork"},
   {forkforkfork, "forkforkfork"},
@@ -2615,6 +3613,7 @@ struct test {
   {bigfile, "bigfile"},
   {fourteen, "fourteen"},
   {rmdot, "rmdot"},
+  {rmcwd, "rmcwd"},
   {dirfile, "dirfile"},
   {iref, "iref"},
   {forktest, "forktest"},
@@ -2622,6 +3621,11 @@ struct test {
   {sbrkmuch, "sbrkmuch"},
   {kernmem, "kernmem"},
   {MAXVAplus, "MAXVAplus"},
+  {vdso, "vdso"},
+  {ring, "ring"},
+  {rwvec, "rwvec"},
+  {pollpipe, "pollpipe"},
+  {manyfds, "manyfds"},
   {sbrkfail, "sbrkfail"},
   {sbrkarg, "sbrkarg"},
   {validatetest, "validatetest"},
@@ -2629,6 +3633,8 @@ struct test {
   {bigargtest, "bigargtest"},
   {argptest, "argptest"},
   {stacktest, "stacktest"},
+  {stackguard, "stackguard"},
+  {stackgrow, "stackgrow"},
   {textwrite, "textwrite"},
   {pgbug, "pgbug" },
   {sbrkbugs, "sbrkbugs" },
@@ -2924,6 +3930,41 @@ outofinodes(char *s)
   }
 }
 
+// between a parent and its child, use more memory than the
+// machine has, so that pages must be swapped out and back in,
+// and check that each keeps its contents. the child shares
+// the parent's swapped-out pages until it touches them.
+void
+swaptest(char *s)
+{
+  enum { SZ = 72*1024*1024, NPAGE = SZ/4096 };
+  char *p;
+  int pid, xstatus;
+
+  if((p = sbrk(SZ)) == (char*)-1){
+    printf("%s: sbrk failed\n", s);
+    exit(1);
+  }
+  for(int i = 0; i < NPAGE; i++)
+    *(int*)(p + i*4096) = i;
+
+  pid = fork();
+  if(pid < 0){
+    printf("%s: fork failed\n", s);
+    exit(1);
+  }
+  for(int i = NPAGE-1; i >= 0; i--){
+    if(*(int*)(p + i*4096) != i){
+      printf("%s: page %d lost its contents\n", s, i);
+      exit(1);
+    }
+  }
+  if(pid == 0)
+    exit(0);
+  wait(&xstatus);
+  exit(xstatus);
+}
+
 struct test slowtests[] = {
   {bigdir, "bigdir"},
   {manywrites, "manywrites"},
@@ -2931,6 +3972,7 @@ struct test slowtests[] = {
   {execout, "execout"},
   {diskfull, "diskfull"},
   {outofinodes, "outofinodes"},
+  {swaptest, "swaptest"},
     
   { 0, 0},
 };
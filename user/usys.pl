@@ -14,6 +14,18 @@ sub entry {
     print " ecall\n";
     print " ret\n";
 }
+
+# getpid() and uptime() are answered in user space from pages
+# the kernel maps into every process (see ulib.c); the system
+# calls themselves remain, as sys_getpid() and sys_uptime().
+sub sysentry {
+    my $name = shift;
+    print ".global sys_$name\n";
+    print "sys_${name}:\n";
+    print " li a7, SYS_${name}\n";
+    print " ecall\n";
+    print " ret\n";
+}
 	
 entry("fork");
 entry("exit");
@@ -32,7 +44,20 @@ entry("link");
 entry("mkdir");
 entry("chdir");
 entry("dup");
-entry("getpid");
+sysentry("getpid");
 entry("sbrk");
 entry("sleep");
-entry("uptime");
+sysentry("uptime");
+entry("ringsetup");
+entry("ringenter");
+entry("readv");
+entry("writev");
+entry("pread");
+entry("pwrite");
+entry("poll");
+entry("fcntl");
+entry("spawn");
+entry("sysstat");
+entry("perfopen");
+entry("perfread");
+entry("getprocinfo");